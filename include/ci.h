@@ -33,6 +33,39 @@ typedef struct tagCICACHE
 	char	cache[CI_CACHE_SIZE + CI_CACHE_EXTRA_LENGTH];		//cache
 }CICACHE;
 
+//Cache˵
+//cacheвʹöƶ´׷ĩβ¾˳LRUԼʹ
+//ʾͨɢбҴcacheLRU˳УȥɵCI_MOVE_SIZE
+//ǰͬLRU˳Уļʽԭͬ
+#define	CI_CACHE_MAX_ITEMS			(CI_CACHE_SIZE / 6 + 1)		//Ŀ̵ĴΪ6ֽڣ
+#define	CI_CACHE_HASH_SIZE			0x10000				//ɢбͰĿ
+
+//ƥƬȫʿƥ䵽ĴʣƬڡģʽΪúѡĸ׶
+//ʡʡִʡ룩ãͬһƬֻһδʿ⡣ʿ⡢Cache
+//øı䣬Լȫ
+#define	CI_LATTICE_HASH_SIZE		0x400				//ƬɢбͰĿ
+#define	CI_LATTICE_MAX_SPANS		0x400				//ƬĿ
+#define	CI_LATTICE_MAX_WORDS		0x4000				//ĴĿ
+
+typedef struct tagCICACHEENTRY
+{
+	int				pos;			//cacheеλ
+	int				prev;			//LRUнµĴ0Ϊû
+	int				next;			//LRUнϾɵĴ0Ϊû
+	int				hash_next;		//ɢбͬһͰеһ0Ϊ
+	unsigned int	stamp;			//ʹţԽԽ
+}CICACHEENTRY;
+
+typedef struct tagCICACHEINDEX
+{
+	int				head;							//µĴ
+	int				tail;							//ɵĴ
+	int				entry_count;					//Ŀ
+	unsigned int	stamp;							//ʹ
+	int				buckets[CI_CACHE_HASH_SIZE];	//ɢб0Ϊ
+	CICACHEENTRY	entries[CI_CACHE_MAX_ITEMS + 1];	//0Ų
+}CICACHEINDEX;
+
 //´ʼ¼ṹ
 //B0ʳȣB1ڳ
 //B2 B3...  
@@ -58,6 +91,9 @@ int GetCiCandidatesByLetters(int wordlib_id, const char *letters, int letters_co
 //ʻ㱻ûѡк뵽CacheУûʹöȡ
 extern void ProcessCiSelected(SYLLABLE *syllable, int syllable_length, HZ *hz, int hz_length);
 
+//жϴǷڵҪ
+extern int CiContainTone(SYLLABLE *syllable_array, int syllable_count, WORDLIBITEM *item, int wild_compare);
+
 //ʺѡء
 extern int UnifyCiCandidates(CANDIDATE *candidates, int count);
 
@@ -67,6 +103,9 @@ extern int AddCi(SYLLABLE *syllable, int syllable_length, HZ *ci, int hz_length)
 //ʺѡ
 extern void SortCiCandidates(CANDIDATE *candidates, int count);
 
+//һβиǰ׺ĴʣȵProcessCiCandidateʹ
+extern void PrepareCiPrefixCandidates(SYLLABLE *syllable_array, int syllable_count, int min_count, int same_ci_syllable_length);
+
 //ڴʵĺѡ
 extern int ProcessCiCandidate(SYLLABLE *syllable_array, int syllable_count, const TCHAR *letters, CANDIDATE *candidate_array, int candidate_length, int same_ci_syllable_length);
 
@@ -76,6 +115,7 @@ extern int GetMixedParseCiCandidate(SYLLABLE *syllable_array, int syllable_count
 //ôʵcacheϢ
 extern int GetCiCacheInfo(HZ *hz, int length);
 extern int GetCiUsedCount(int cache_pos);
+extern unsigned int GetCiCacheStamp(int cache_pos);
 extern void InsertCiToCache(HZ *hz, int length, int syllable_length, int set_fix_top);
 
 //װءCache
@@ -92,6 +132,8 @@ extern WORDLIBITEMV6B1 *GetNextCiItemV6B1(WORDLIBITEMV6B1 *item);
 extern WORDLIBITEM *GetNextCiItem(WORDLIBITEM *item);
 extern HZ *GetItemHZPtr(WORDLIBITEM *item);
 extern int GetItemLength(int hz_length, int syllable_length);
+extern SYLLABLE *GetItemSyllablePtr(WORDLIBITEM *item);
+extern int CompareSyllableKey(const SYLLABLE *syllable1, int length1, const SYLLABLE *syllable2, int length2);
 
 //ǷΪ´ʣ뵽´ʱ
 //extern void CheckNewUserWord(SYLLABLE *syllables, int syllable_length, HZ *ci_string, int ci_length);
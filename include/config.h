@@ -592,6 +592,18 @@ typedef struct tagHYPIMCONFIG
 	int		main_window_x;							//xλãĬ500
 	int		main_window_y;							//yλãĬ500
 
+	//ÿһ·Ŀȣʺѡһʱʹã
+	int		icw_beam_width;							//ĬΪ4
+
+	//ʺѡĿΪ1ʱǰֻͬںѡзһʽʱ·
+	int		icw_candidate_count;					//ĬΪ1
+
+	//ÿΰúѡʱƣ룬0Ϊƣ
+	int		candidate_time_limit;					//ĬΪ100
+
+	//úѡʹõ߳Ŀ0ΪմĿ1Ϊֻʹ뷨̣߳
+	int		candidate_thread_count;					//ĬΪ0
+
 } PIMCONFIG;
 
 //ȫֹϢ
@@ -133,6 +133,8 @@ typedef struct tagPIMCONTEXT
 	int			candidate_count;										//ѡĿ
 	int			candidate_index;										//ʾѡĵһ
 	int			candidate_selected_index;								//ѡеĺѡ
+	int			candidate_ordered_count;							//ѾźĺѡĿ0Ϊȫ
+	int			candidate_incomplete;									//ѡΪʱûȫʱΪĴ10Ϊ
 
 	//ǰҳҪʾĺѡ
 	TCHAR		candidate_string[MAX_CANDIDATES_PER_LINE * MAX_CANDIDATE_LINES][MAX_CANDIDATE_STRING_LENGTH + 2];
@@ -45,9 +45,11 @@ extern void JumpToZiOrNextPage(PIMCONTEXT *context);
 extern void ClearSelectedDigital(PIMCONTEXT *context);
 extern void DeleteCi(PIMCONTEXT *context, int selected_index);
 extern void MakeCandidate(PIMCONTEXT *context);
+extern int RefineCandidates(PIMCONTEXT *context);
 extern int BackSelectedCandidate(PIMCONTEXT *context);
 extern int GetCandidateSyllable(CANDIDATE *candidate, SYLLABLE *syllables, int length);
 extern int GetCandidateSyllableCount(CANDIDATE *candidate);
+extern int GetCandidateString(PIMCONTEXT *context, CANDIDATE *candidate, TCHAR *buffer, int length);
 extern int GetCandidateDisplayString(PIMCONTEXT *context, CANDIDATE *candidate, TCHAR *buffer, int length, int first_candidate);
 extern void CheckDeleteNewCi(int key);
 extern void PrepareDeleteNewCi(HZ *new_ci, int ci_length, SYLLABLE *syllable, int syllable_length);
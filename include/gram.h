@@ -103,6 +103,16 @@ typedef struct tagGRAM_DATA
 
 #pragma pack()
 
+#define	BIGRAM_WORD_SINGLE			(1 << 0)				//
+#define	BIGRAM_WORD_SENTENCE		(1 << 1)				//俪ʼǣ
+
+//bigramеıʶGetBigramWord
+typedef struct tagBIGRAM_WORD
+{
+	int		index;											//ڵһеλãС0Ϊûҵ
+	int		flag;											//֡
+}BIGRAM_WORD;
+
 #ifdef	__cplusplus
 extern "C" 
 {
@@ -110,6 +120,8 @@ extern "C"
 
 int GetBigramCount(GRAM_DATA *bigram_data, const char *ci1, const char *ci2);
 double GetBigramValue(GRAM_DATA *bigram_data, const char *ci1, const char *ci2);
+void GetBigramWord(GRAM_DATA *bigram_data, const char *ci, BIGRAM_WORD *word);
+double GetBigramValueByWord(GRAM_DATA *bigram_data, const BIGRAM_WORD *word1, const BIGRAM_WORD *word2);
 double GetBackOffProbability(GRAM_DATA *bigram_data, int index1, int index2);
 
 #define	GetGramWordList(bigram)	((char*)bigram + bigram->header.word_list_pos)
@@ -15,10 +15,16 @@ extern "C" {
 #define	BIGRAM_FILE_NAME		TEXT("unispim6\\wordlib\\bigram.dat")
 
 #define	ICW_MAX_ITEMS			1024					//ÿһICWѡĿ
-#define	ICW_MAX_CI_ITEMS		256						//ÿĴĿ
+#define	ICW_MAX_CI_ITEMS		256						//ÿĿԼʣ
+#define	ICW_MAX_ZI_ITEMS		128						//ÿĺĿλ
 #define	ICW_MAX_PART_SYLLABLES	5						//5ȫ
+#define	ICW_MAX_BEAM_WIDTH		8						//ÿһౣ·Ŀ
+#define	ICW_MAX_WORD_LENGTH		8						//ʹõĴʵ
+#define	ICW_MAX_STATES			4						//״̬Ŀÿڲʹһ
 
 extern int GetIcwCandidates(SYLLABLE *syllable, int syllable_count, CANDIDATE *candidate);
+extern int GetIcwCandidatesOfParses(SYLLABLE **syllables, const int *syllable_counts, int parse_count, CANDIDATE *candidate, int candidate_length);
+extern int MeasureIcwBeamWidths(SYLLABLE *syllable, int syllable_count, int times, LONGLONG *ticks);
 extern int LoadBigramData(const TCHAR *name);
 extern int FreeBigramData();
 extern int MakeBigramFaster();
@@ -38,9 +38,11 @@ extern int	window_logon;
 #define		WORDLIB_V5_BKUP				9							//V5ıݴʿļ
 #define		WORDLIB_V6B2				10							//ʿΪV6B2ʿ
 #define		WORDLIB_V66					66							//ʿΪV6.6ʿ
+#define		WORDLIB_V66C				67							//ʿΪV6.6루ֻ򣩴ʿ
 
 #define		HYPIM_VERSION					6						//뷨汾
 #define		HYPIM_WORDLIB_V66_SIGNATURE		0x14091994				//뷨ʿV66־
+#define		HYPIM_WORDLIB_V66C_SIGNATURE	0x140A1994				//뷨ʿV66־
 #define		HYPIM_WORDLIB_V6_SIGNATURE		0x14081994				//뷨ʿV6־
 #define		HYPIM_WORDLIB_V6B2_SIGNATURE	0x14071994				//뷨ʿV6B2־
 #define		HYPIM_WORDLIB_V6B1_SIGNATURE	0x14061994				//뷨ʿV6B1־
@@ -179,6 +181,7 @@ typedef struct tagHZCANDIDATE
 	int			top_pos;					//̶ֱʶ0ǹ̶֣1-7Ϊ̶λá
 	int			cache_pos;					//CACHEеλãжĺ
 	int			is_word;					//ǷΪ(磺)
+	int			used_count;					//ʹöȣʱһλãȽʱٲѯCache
 	SYLLABLE    origin_syllable;            //СڴʶӦԭʼڣxi'anԭʼxian
 }HZCANDIDATE;
 
@@ -192,6 +195,8 @@ typedef struct tagWORDCANDIDATE
 	SYLLABLE		*syllable;				//ָʿָ
 	HZ				*hz;					//ֵָָ
 	int				origin_syllable_length;	//ԭʼڳ(˫ɵڳȲ)
+	int				used_count;				//ʹöȣʱһλãȽʱٲѯCache
+	unsigned int	cache_stamp;			//Cacheеʹţͬϣ
 }WORDCANDIDATE;
 
 //Դʶֺѡ
@@ -251,6 +256,40 @@ struct tagPIMCONTEXT;
 //ȡѡ
 extern int GetCandidates(struct tagPIMCONTEXT *context, const TCHAR *input_string, SYLLABLE *syllables, int syllable_count, CANDIDATE *candidate_array, int array_length, int need_spw);
 
+//ѡʱֻźÿǰĺѡĺѡڷҳ򲿷ʱȫ
+#define		CANDIDATE_TOP_COUNT			(MAX_CANDIDATES_PER_LINE * MAX_CANDIDATE_LINES * 2)	//ÿźõĺѡĿ
+#define		CANDIDATE_ORDERED_COUNT		(MAX_CANDIDATES_PER_LINE * MAX_CANDIDATE_LINES)		//֤ĺѡĿڶʵȵƶ
+
+//ǰѡֻҪźõĿ0Ϊȫ
+extern int candidate_top_count;
+
+//ѡʱûȫʱÿβʱƼӱʱ
+#define		CANDIDATE_MAX_REFINE_LEVEL	6
+
+//λúѡΪʱûȫ
+extern int candidate_incomplete;
+
+//ʼúѡļʱ룬0Ϊƣ
+extern void BeginCandidateDeadline(int time_limit);
+
+//úѡļʱ
+extern void EndCandidateDeadline();
+
+//ǷѾúѡʱ
+extern int IsCandidateDeadlinePassed();
+
+//ѡѡеλãʱֻƶźúÿѡֻƶһ
+typedef int CANDIDATEHANDLE;
+
+//վĴкѡ
+extern int ArrangeCandidates(CANDIDATE *candidate_array, const CANDIDATEHANDLE *handles, int count);
+
+//ѡĺѡվĴŵǰѡĴȷ
+extern int ArrangeTopCandidates(CANDIDATE *candidate_array, const CANDIDATEHANDLE *heap, int top_count);
+
+//Ժѡcandidate_top_countΪ0ʱֻźǰĺѡ
+extern void PartialSortCandidates(CANDIDATE *candidate_array, int count, int (*compare)(const CANDIDATE*, const CANDIDATE*));
+
 #ifdef __cplusplus
 }
 #endif
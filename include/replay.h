@@ -0,0 +1,49 @@
+/*	طͷļ
+ *	طż¼İУͳÿһΰԼ׶εĺʱܱȽϡ
+ */
+
+#ifndef	_REPLAY_H_
+#define	_REPLAY_H_
+
+#include <kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	REPLAY_STAGE_KEY				0			//
+#define	REPLAY_STAGE_PARSE				1			//ƴ
+#define	REPLAY_STAGE_CANDIDATE			2			//úѡ
+#define	REPLAY_STAGE_ICW				3			//
+#define	REPLAY_STAGE_DISPLAY			4			//ѡַ
+#define	REPLAY_STAGE_REFINE				5			//֮󲹳䳬ʱûвĺѡ밴
+#define	REPLAY_STAGE_COUNT				6
+
+#define	REPLAY_MAX_KEYS					0x10000		//طŵİĿ
+#define	REPLAY_MAX_LINE_LENGTH			0x400		//ļг
+#define	REPLAY_ICW_BEAM_TIMES			10			//ȽʼʱÿеĽ
+
+//׶μʱֻڻطʱ
+#define	REPLAY_STAGE_BEGIN(stage)		do { if (replay_running) ReplayStageBegin(stage); } while(0)
+#define	REPLAY_STAGE_END(stage)			do { if (replay_running) ReplayStageEnd(stage); } while(0)
+
+//Ƿڻط
+extern int replay_running;
+
+//׶οʼʱ
+extern void ReplayStageBegin(int stage);
+
+//׶νʱ
+extern void ReplayStageEnd(int stage);
+
+//طŰļʱͳд뱨ļ
+extern int ReplayKeyTrace(const TCHAR *trace_file_name, const TCHAR *report_file_name);
+
+//طŰļʹù߳˳õĺѡǷͬͬİд뱨ļ
+extern int ReplayCheckWorkers(const TCHAR *trace_file_name, const TCHAR *report_file_name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
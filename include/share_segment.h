@@ -40,12 +40,14 @@ typedef struct tagSHARE_SEGMENT
 	int	wordlib_length[MAX_WORDLIBS * 2];							//ʿⳤ
 	int wordlib_deleted[MAX_WORDLIBS * 2];							//ʿǷѾɾ
 	TCHAR wordlib_shared_name[MAX_WORDLIBS * 2][0x20];				//ڴıʶ
+	int wordlib_version[MAX_WORDLIBS * 2];							//ʿ޸ļڸ̴ʿĸ£
 
 	int	bh_loaded;													//ʻǷѾڴ
 
 	CICACHE	ci_cache;												//cache
 	int	ci_cache_loaded;											//ǷѾװ
 	int	ci_cache_modified;											//Ƿı
+	CICACHEINDEX ci_cache_index;									//cache
 
 	//NEWCI new_ci;													//´ʱ
 	//int	new_ci_loaded;												//Ƿװ
@@ -102,6 +104,8 @@ typedef struct tagSHARE_SEGMENT
 
 	int fontmap_loaded;                                             //font map loaded?
 	int gbkmap_loaded;                                              //gbk map genernate?
+
+	int candidate_data_version;										//ѡݣʿ⡢Cacheȣ޸ļڸ̺ѡĸ£
 }SHARE_SEGMENT;
 
 extern SHARE_SEGMENT *share_segment;
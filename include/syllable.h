@@ -196,6 +196,7 @@ typedef struct tagNOREVERSESYLLABLE
 #define	FUZZY_ZCS_IN_CI				(1 << 24)				//ĬΪ0ʱû
 #define	FUZZY_SUPER					(1 << 25)				//ĸģ
 #define	FUZZY_CI_SYLLABLE_LENGTH	(1 << 26)				//ģʳڳ
+#define	FUZZY_CI_TONE				(1 << 27)				//ʱʿʱϵĴ
 
 //ƴѡ
 //#define CORRECT_GN_NG               (1 << 0)
@@ -215,6 +216,15 @@ struct tagPIMCONTEXT;
 //extern const int syllable_map_items;
 //extern const int syllablev5_map_items;
 
+//ģõƥڹ߳̽ڱȽ֮ǰã
+extern void PrepareSyllableMatchTable(int fuzzy_mode);
+
+//ݵڿܵĸiλΪĸia-zΪ1-260Ϊûĸ
+extern unsigned int GetSyllableFirstLetters(SYLLABLE syllable, int fuzzy_mode);
+
+//ƥģĽǷһ£زһµģĿ
+extern int CheckSyllableMatchTables(int *checked_count);
+
 //ʹıȽϣжϵһڲָʾڼǷڶڲ
 extern int ContainSyllable(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode);
 
@@ -241,6 +251,9 @@ extern int GetOtherSyllableParse(struct tagPIMCONTEXT *context, int syllable_sta
 //жĸǷĸͬڵȡʡ
 extern int SyllableStartWithLetter(TCHAR ch, SYLLABLE syllable);
 
+//ڵĸڷ0
+extern TCHAR GetSyllableFirstLetter(SYLLABLE syllable);
+
 //жϵһڲָʾĸǷڶڲĸ
 extern int ContainCon(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode);
 
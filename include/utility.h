@@ -32,6 +32,18 @@ extern "C" {
 #define	KEY_ALT					(1 << 8)
 #define	KEY_CAPITAL				(1 << 9)
 
+//ʱڴأúѡʱʹõʱӳ˳䣬ÿΰõѡһȫͷţ
+//ٷmalloc/freeɿɣͷźظʹá
+#define	TEMP_MEMORY_BLOCK_SIZE			0x40000			//ÿһĬϴС256K
+#define	TEMP_MEMORY_MAX_BLOCKS			16				//ĿĿ
+
+//ʱڴصķλãͷĳλ֮ڴ
+typedef struct tagTEMPMEMORYMARK
+{
+	int		block;						//ǰ
+	int		used;						//ǰѾʹõĳ
+} TEMPMEMORYMARK;
+
 //ڴϢ
 typedef struct tagSHAREDMEMORYINFO
 {
@@ -86,9 +98,24 @@ extern void *GetReadOnlySharedMemory(const TCHAR *shared_name);
 //ڴ
 extern void *AllocateSharedMemory(const TCHAR *shared_name, int length);
 
+//ļֻʽӳΪڴ
+extern void *MapFileToSharedMemory(const TCHAR *shared_name, const TCHAR *file_name);
+
 //ͷŹڴ
 extern void FreeSharedMemory(const TCHAR *shared_name, void *pointer);
 
+//ʱڴзڴ
+extern void *AllocateTempMemory(int length);
+
+//ʱڴصķλ
+extern TEMPMEMORYMARK GetTempMemoryMark();
+
+//ͷʱڴĳλ֮ڴ
+extern void FreeTempMemory(TEMPMEMORYMARK mark);
+
+//ͷʱڴеȫڴ棨ÿΰõѡã
+extern void ResetTempMemory();
+
 //ƶʼ
 extern void DragStart(HWND window);
 
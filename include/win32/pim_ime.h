@@ -22,6 +22,7 @@ extern "C" {
 #define UIM_RECENT_CI				(WM_USER + 0x108)		//Ĵ
 #define UIM_ENGLISH_INPUT			(WM_USER + 0x109)		//лӢ뷨
 #define UIM_STATUS_WINDOW_CHANGED	(WM_USER + 0x110)		//״̬λøı
+#define UIM_REFINE_CANDIDATE		(WM_USER + 0x111)		//䳬ʱûȫĺѡ
 
 //#define	UPDATE_NOTIFY_FINISHED		0						//
 //#define	UPDATE_NOTIFY_WAIT			1						//Ҫȴ
@@ -66,6 +67,7 @@ extern void SetConversionStatus(HIMC hIMC, LPINPUTCONTEXT pIMC, PIMCONTEXT *cont
 extern void GetConversionStatus(HIMC hIMC, LPINPUTCONTEXT pIMC, PIMCONTEXT *context);
 
 extern void GenerateImeMessage(HIMC hIMC, UINT uMsg, WPARAM wParam, LPARAM lParam);
+extern void MakeCompositionAndCandidate(LPINPUTCONTEXT pIMC, PIMCONTEXT *context);
 extern int SetIMCContext(LPINPUTCONTEXT pIMC);
 
 #ifdef __cplusplus
@@ -51,6 +51,10 @@ typedef struct tagWORDLIBHEADER
 	int			can_be_edit;						//ǷԱ༭
 	int			pim_version;						//뷨汾ţԿǣ
 	int			index[CON_NUMBER][CON_NUMBER];		//
+	int			sorted_index_pos;					//ʿ⣺ƫƱλãԴʿʼ
+	int			sorted_item_count;					//ʿ⣺ƫƱ
+	int			free_page_count;					//ҳĿ
+	int			free_page_no;						//ҳĵһҳҳĿΪ0ʱЧ
 } WORDLIBHEADER;
 
 //ҳ
@@ -77,6 +81,13 @@ typedef	struct tagWORDLIB
 	PAGE				pages[1];					//ҳ
 } WORDLIB;
 
+//ʿ˵
+//ʿ⣨HYPIM_WORDLIB_V66C_SIGNATUREV66ʿɣֻ
+//1ҳV66ͬÿҳеĴ򣬲ȥɾĴ
+//2ҳ֮ΪƫƱint飩Уĸĸ
+//   ڶֲң
+//3װʱֱӳļٸƵڴС
+
 //V5ʿⶨ
 typedef struct tagWORDLIBV5
 {
@@ -114,6 +125,15 @@ typedef struct tagUPDATEITEM
 #define	WLE_NOCI					(-6)
 #define	WLE_OTHER					(-10)
 
+//ʿԵĽ
+typedef struct tagCOMPACTTESTREPORT
+{
+	int		operation_count;			//ӡĴ
+	int		round_count;				//
+	double	before_p50, before_p99;		//ǰôʺѡĺʱ΢룩
+	double	after_p50, after_p99;		//ôʺѡĺʱ΢룩
+}COMPACTTESTREPORT;
+
 //װشʿļ
 extern int LoadWordLibrary(const TCHAR *wordlib_name);
 
@@ -138,6 +158,18 @@ extern int DeleteCiFromWordLib(int wordlib_id, HZ *hz, int hz_length, SYLLABLE *
 //װشʿļݳȣһڴʿļװûʿļ
 extern int LoadWordLibraryWithExtraLength(const TCHAR *lib_name, int extra_length, int check_exist);
 
+//V66ʿɱʿ
+extern int CompileWordLibrary(const TCHAR *wordlib_file_name, const TCHAR *compiled_file_name);
+
+//ʿ⣺ĴռõĿռԼҳ
+extern int CompactWordLibrary(int wordlib_id);
+
+//ʿѹԣɾЧʧҲ
+extern int TestCompactWordLibrary(const TCHAR *wordlib_file_name, int operation_count, COMPACTTESTREPORT *report);
+
+//жϴʿǷΪʿ
+extern int IsCompiledWordLibrary(WORDLIB *wordlib);
+
 //װûʿļ
 extern int LoadUserWordLibrary(const TCHAR *wordlib_name);
 
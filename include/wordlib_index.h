@@ -0,0 +1,122 @@
+/*	ʿͷļ
+ *	ʿΪÿ˽еݣʿڹڴУӳַͬ
+ *	ֻԴʿʼƫơʿⱻ޸ĺͨеĴʿ޸
+ *	֪ͨؽ
+ */
+
+#ifndef	_WORDLIB_INDEX_H_
+#define	_WORDLIB_INDEX_H_
+
+#include <kernel.h>
+#include <syllable.h>
+#include <wordlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	WORDLIB_TRIE_DEPTH				3			//ȣڽڵĴ˳Ƚ
+#define	WORDLIB_TRIE_MAX_PENDING		256			//δĿ
+
+//ڵ㣬ͬһڵӽڵţڣĸĸ
+typedef struct tagWORDLIBTRIENODE
+{
+	SYLLABLE		syllable;						//ڵڣ
+	unsigned short	child_count;					//ӽڵĿ
+	int				first_child;					//һӽڵλ
+	int				item_start;						//еĴеĿʼλ
+	int				item_end;						//еĴеĽλ
+} WORDLIBTRIENODE;
+
+//ڵ0Ϊڵ㡣ڵĴУڳȵڽڵȵĴǰ档
+typedef struct tagWORDLIBTRIE
+{
+	int				version;						//ʱĴʿ޸ļ
+	int				node_count;						//ڵĿ
+	WORDLIBTRIENODE	*nodes;							//ڵ
+	int				item_count;						//Ŀ
+	int				*items;							//Ĵƫ
+	int				pending_count;					//ĴĿ
+	int				pending[WORDLIB_TRIE_MAX_PENDING];	//Ĵƫ
+} WORDLIBTRIE;
+
+#define	WORDLIB_HASH_EXTRA_ITEMS		0x400		//ɢбΪԤĿ
+
+//ɢбڣĸĸԼΪڴǷڵж
+typedef struct tagWORDLIBHASH
+{
+	int				version;						//ʱĴʿ޸ļ
+	int				bucket_count;					//ͰĿ2ݣ
+	int				*buckets;						//Ͱеĵһ-1Ϊ
+	int				item_count;						//Ŀ
+	int				item_capacity;					//
+	int				*items;							//ƫ
+	int				*next;							//ͬһͰеһ-1Ϊ
+} WORDLIBHASH;
+
+#define	WORDLIB_LETTER_MAX_PENDING		256			//δĸĿ
+
+//ĸԴʵĸ"zgrm"Ϊĸ
+typedef struct tagWORDLIBLETTERINDEX
+{
+	int				version;						//ʱĴʿ޸ļ
+	int				item_count;						//Ŀ
+	int				*items;							//ĸĴƫƣĸͬĴҳе˳
+	int				pending_count;					//ĴĿ
+	int				pending[WORDLIB_LETTER_MAX_PENDING];	//Ĵƫ
+} WORDLIBLETTERINDEX;
+
+//ֵڳȡʳǷڳԼǰڵĸҳдĿٹ
+#define	WORDLIB_KEY_LENGTH_MASK			0x3f		//ڳ
+#define	WORDLIB_KEY_SAME_LENGTH			(1 << 6)	//ʳȵڳ
+#define	WORDLIB_KEY_LETTER_SHIFT		7			//ĸʼλ
+#define	WORDLIB_KEY_LETTER_BITS			5			//ÿĸռõλa-zΪ1-260ΪûУ
+#define	WORDLIB_KEY_LETTER_COUNT		4			//ֵеĸĿ
+#define	WORDLIB_KEY_LETTER_MASK			((1 << WORDLIB_KEY_LETTER_BITS) - 1)
+
+//һҳĴĿһֵĴʣ
+#define	WORDLIB_PAGE_MAX_ITEMS			(WORDLIB_PAGE_DATA_LENGTH / (WORDLIB_FEATURE_LENGTH + sizeof(SYLLABLE) + sizeof(HZ)))
+
+//ҳֵÿҳĴڱţɨҳʱֻȽϼֵҪ䳤Ĵ
+typedef struct tagWORDLIBPAGEKEYS
+{
+	int				version;						//ֵʱĴʿ޸ļ
+	int				page_count;						//ҳ
+	int				*page_start;					//ÿҳһڱеλãpage_count + 1
+	int				*data_length;					//ֵʱҳݳȣ뵱ǰͬʱֱӱҳ
+	unsigned short	*offsets;						//ҳеƫ
+	unsigned int	*keys;							//ֵ
+} WORDLIBPAGEKEYS;
+
+//ôļֵ
+extern unsigned int GetWordLibItemKey(WORDLIBITEM *item);
+
+//ҳмֵҪ(ֵ & key_mask) == key_valueĴҳе˳
+extern int GetWordLibPageItems(int wordlib_id, PAGE *page, unsigned int key_mask, unsigned int key_value, WORDLIBITEM **items);
+
+//ͨʿôʺѡʱ-1
+extern int GetCiInWordLibIndex(int wordlib_id, SYLLABLE *syllable_array, int syllable_count, CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode, int wild_compare);
+
+//ͨʿһλøǰ׺min_countsyllable_countڣĴʺѡʱ-1
+extern int GetCiPrefixesInWordLibIndex(int wordlib_id, SYLLABLE *syllable_array, int syllable_count, int min_count, CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode);
+
+//ͨĸôʺѡͨʱ-1
+extern int GetCiInWordLibLetterIndex(int wordlib_id, const TCHAR *letters, int letter_count, CANDIDATE *candidate_array, int candidate_length);
+
+//ͨʿҴڡȫͬʱ-1
+extern int FindCiInWordLibIndex(int wordlib_id, HZ *hz, int hz_length, SYLLABLE *syllable, int syllable_length, WORDLIBITEM **item);
+
+//ʿµĴ
+extern void AddItemToWordLibIndex(int wordlib_id, WORDLIBITEM *item);
+
+//ʿⱻı䣨װءرգн̶Ҫؽ
+extern void InvalidateWordLibIndex(int wordlib_id);
+
+//ͷű̵Ĵʿ
+extern void FreeWordLibIndex(int wordlib_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
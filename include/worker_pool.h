@@ -0,0 +1,43 @@
+/*	̳߳ͷļ
+ *	úѡʱĲңڸʿвҴʣɹ߳߳ͬʱУ
+ *	ĽдԼĻɵ߰Ĵϲ˳ִͬ
+ */
+
+#ifndef	_WORKER_POOL_H_
+#define	_WORKER_POOL_H_
+
+#include <kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	WORKER_MAX_THREADS				7			//Ĺ߳Ŀ̣߳
+
+//
+typedef void (*WORKERPROC)(void *param);
+
+//
+typedef struct tagWORKERTASK
+{
+	WORKERPROC		proc;						//
+	void			*param;						//
+} WORKERTASK;
+
+//Ϊ1ʱȫڵ߳˳ִУ벢ִеĽȽϣ
+extern int worker_serial;
+
+//ÿʹõĹ߳Ŀ̣߳0Ϊֻ˳ִ
+extern int GetWorkerCount();
+
+//ִһȫɺ󷵻
+extern void RunWorkerTasks(WORKERTASK *tasks, int task_count);
+
+//ȫ߳
+extern void FreeWorkerPool();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -181,11 +181,29 @@ double GetBackOffProbability(GRAM_DATA *bigram_data, int index1, int index2)
 	return value * factor * back_off_weight;
 }
 
-/**	bigram
+/**	ôbigramеıʶֵʱõĴʣֻҪһδʱ
  */
-double GetBigramValue(GRAM_DATA *bigram_data, const char *ci1, const char *ci2)
+void GetBigramWord(GRAM_DATA *bigram_data, const char *ci, BIGRAM_WORD *word)
+{
+	word->index = -1;
+	word->flag  = 0;
+
+	if (!bigram_data || !ci)
+		return;
+
+	word->index = GetCiIndex(bigram_data, ci);
+
+	if (!ci[0] || !ci[1] || !ci[2])					//
+		word->flag |= BIGRAM_WORD_SINGLE;
+
+	if (*(short*)ci == *(short*)"")				//俪ʼ
+		word->flag |= BIGRAM_WORD_SENTENCE;
+}
+
+/**	ͨʵıʶbigram
+ */
+double GetBigramValueByWord(GRAM_DATA *bigram_data, const BIGRAM_WORD *word1, const BIGRAM_WORD *word2)
 {
-	char *word_list;
 	GRAM_INDEX *index0;
 	GRAM_ITEM  *item;
 	double value;
@@ -194,16 +212,14 @@ double GetBigramValue(GRAM_DATA *bigram_data, const char *ci1, const char *ci2)
 	int start, end, mid, ret, count;
 	int start_sav, end_sav;
 
-	if (!bigram_data || !ci1 || !ci2)				//ϷԼ
+	if (!bigram_data || !word1 || !word2)			//ϷԼ
 		return 1 / MAX_BCOUNT;
 
 	index0	  = GetGramIndex(bigram_data);
 	item	  = GetGramItem(bigram_data);
-	word_list = GetGramWordList(bigram_data);
 
-	//ѰҴ
-	ci1_index = GetCiIndex(bigram_data, ci1);
-	ci2_index = GetCiIndex(bigram_data, ci2);
+	ci1_index = word1->index;
+	ci2_index = word2->index;
 
 	ci1_freq = ci2_freq = 0;
 	if (ci1_index >= 0)
@@ -220,7 +236,7 @@ double GetBigramValue(GRAM_DATA *bigram_data, const char *ci1, const char *ci2)
 		//ֱӷci2Ĺֵ
 		value = 1.0	* ci2_freq / bigram_data->header.total_word_freq;
 
-		if (!ci2[2] && *(short*)ci1 != *(short*)"")
+		if ((word2->flag & BIGRAM_WORD_SINGLE) && !(word1->flag & BIGRAM_WORD_SENTENCE))
 			value *= XM;
 
 		return value;
@@ -232,7 +248,7 @@ double GetBigramValue(GRAM_DATA *bigram_data, const char *ci1, const char *ci2)
 		//ci2wordlistУԲڴƵ˽ƵΪ1м
 		value = 1.0	/ bigram_data->header.total_word_freq * (ci1_freq - index0[ci1_index].start_count) / ci1_freq;
 
-		if (!ci2[2] && *(short*)ci1 != *(short*)"")
+		if ((word2->flag & BIGRAM_WORD_SINGLE) && !(word1->flag & BIGRAM_WORD_SENTENCE))
 			value *= XM;
 
 		return value;
@@ -280,12 +296,28 @@ double GetBigramValue(GRAM_DATA *bigram_data, const char *ci1, const char *ci2)
 
 	value = 1.0 * count / ci1_freq;
 
-	if (!ci1[2] && !ci2[2] && *(short*)ci1 != *(short*)"" && *(short*)ci2 != *(short*)"")				//ǵ֣Ƶʴ
+	if ((word1->flag & BIGRAM_WORD_SINGLE) && (word2->flag & BIGRAM_WORD_SINGLE) &&
+		!(word1->flag & BIGRAM_WORD_SENTENCE) && !(word2->flag & BIGRAM_WORD_SENTENCE))				//ǵ֣Ƶʴ
 		value *= XM;
 
 	return value;
 }
 
+/**	bigram
+ */
+double GetBigramValue(GRAM_DATA *bigram_data, const char *ci1, const char *ci2)
+{
+	BIGRAM_WORD word1, word2;
+
+	if (!bigram_data || !ci1 || !ci2)				//ϷԼ
+		return 1 / MAX_BCOUNT;
+
+	GetBigramWord(bigram_data, ci1, &word1);
+	GetBigramWord(bigram_data, ci2, &word2);
+
+	return GetBigramValueByWord(bigram_data, &word1, &word2);
+}
+
 /**	bigram
  */
 double newGetBigramValue(GRAM_DATA *bigram_data, const char *ci1, const char *ci2)
@@ -5,11 +5,13 @@
 #include <kernel.h>
 #include <syllable.h>
 #include <wordlib.h>
+#include <wordlib_index.h>
 #include <config.h>
 #include <utility.h>
 #include <zi.h>
 #include <ci.h>
 #include <share_segment.h>
+#include <worker_pool.h>
 
 //#pragma	data_seg(HYPIM_SHARED_SEGMENT)
 //CICACHE	ci_cache = {CI_CACHE_V66_SIGNATURE, 0, 0, 0};
@@ -21,6 +23,171 @@
 //int		new_ci_modified = 0;				//ǷѾ޸
 //#pragma data_seg()
 
+/**	ʵɢֵ
+ */
+static unsigned int GetCiCacheHash(HZ *hz, int length)
+{
+	unsigned int value = length;
+	int i;
+
+	for (i = 0; i < length; i++)
+		value = value * 31 + hz[i];
+
+	return value & (CI_CACHE_HASH_SIZE - 1);
+}
+
+/**	ŵLRUǰ棨£
+ */
+static void MoveCiCacheEntryToHead(int entry)
+{
+	CICACHEINDEX *index = &share_segment->ci_cache_index;
+	CICACHEENTRY *e = &index->entries[entry];
+
+	e->stamp = ++index->stamp;
+
+	if (index->head == entry)
+		return;
+
+	//ȡ
+	if (e->prev)
+		index->entries[e->prev].next = e->next;
+
+	if (e->next)
+		index->entries[e->next].prev = e->prev;
+
+	if (index->tail == entry)
+		index->tail = e->prev;
+
+	//ŵͷ
+	e->prev = 0;
+	e->next = index->head;
+
+	if (index->head)
+		index->entries[index->head].prev = entry;
+
+	index->head = entry;
+
+	if (!index->tail)
+		index->tail = entry;
+}
+
+/**	ΪcacheposλõĴLRUĩβɣ
+ *	أ
+ *		ɹʶ
+ *		ʧܣࣩ0
+ */
+static int NewCiCacheEntry(int pos)
+{
+	CICACHEINDEX *index = &share_segment->ci_cache_index;
+	CICACHEENTRY *e;
+	unsigned int bucket;
+	int entry;
+
+	if (index->entry_count >= CI_CACHE_MAX_ITEMS)
+		return 0;
+
+	entry = ++index->entry_count;
+	e	  = &index->entries[entry];
+
+	bucket = GetCiCacheHash((HZ*)&share_segment->ci_cache.cache[pos + WORDLIB_FEATURE_LENGTH], share_segment->ci_cache.cache[pos]);
+
+	e->pos				   = pos;
+	e->stamp			   = 0;
+	e->hash_next		   = index->buckets[bucket];
+	index->buckets[bucket] = entry;
+
+	e->next = 0;
+	e->prev = index->tail;
+
+	if (index->tail)
+		index->entries[index->tail].next = entry;
+
+	index->tail = entry;
+
+	if (!index->head)
+		index->head = entry;
+
+	return entry;
+}
+
+/**	cacheеݽCachecacheеĴ˳Ϊ¾˳
+ *	һĴȥ
+ */
+static void BuildCiCacheIndex()
+{
+	CICACHEINDEX *index = &share_segment->ci_cache_index;
+	int pos = 0, entry;
+	int item_length;
+
+	index->head = index->tail = index->entry_count = 0;
+	memset(index->buckets, 0, sizeof(index->buckets));
+
+	while (pos + WORDLIB_FEATURE_LENGTH <= share_segment->ci_cache.length)
+	{
+		item_length = WORDLIB_FEATURE_LENGTH + share_segment->ci_cache.cache[pos] * sizeof(HZ);
+		if (item_length <= WORDLIB_FEATURE_LENGTH || pos + item_length > share_segment->ci_cache.length)
+			break;
+
+		if (!NewCiCacheEntry(pos))
+			break;
+
+		pos += item_length;
+	}
+
+	share_segment->ci_cache.length = pos;
+
+	//ԽǰĴԽ
+	index->stamp = index->entry_count;
+	for (entry = index->head; entry; entry = index->entries[entry].next)
+		index->entries[entry].stamp = index->entry_count - entry + 1;
+}
+
+/**	LRU˳cacheеĴֻlimitֽڵ´
+ *	
+ *		limit			󳤶
+ *	أ
+ *		ɹ1
+ *		ʧܣ0
+ */
+static int RebuildCiCache(int limit)
+{
+	CICACHEINDEX *index = &share_segment->ci_cache_index;
+	char *data;
+	int  entry, pos, length = 0;
+	int  item_length;
+
+	data = malloc(sizeof(share_segment->ci_cache.cache));
+	if (!data)
+	{
+		Log(LOG_ID, L"ڴ治㣬Cache");
+		return 0;
+	}
+
+	for (entry = index->head; entry; entry = index->entries[entry].next)
+	{
+		pos			= index->entries[entry].pos;
+		item_length = WORDLIB_FEATURE_LENGTH + share_segment->ci_cache.cache[pos] * sizeof(HZ);
+
+		if (length + item_length > limit)
+			break;
+
+		memcpy(data + length, &share_segment->ci_cache.cache[pos], item_length);
+		length += item_length;
+	}
+
+	memcpy(share_segment->ci_cache.cache, data, length);
+	share_segment->ci_cache.length = length;
+
+	free(data);
+
+	BuildCiCacheIndex();
+
+	//±ţ̼ĺѡеĴCacheʶʧЧ
+	share_segment->candidate_data_version++;
+
+	return 1;
+}
+
 /*	Cacheݡ
  *	
  *		ci_cache_file_name			Cacheļ
@@ -34,6 +201,10 @@ int SaveCiCacheData(const TCHAR *ci_cache_file_name)
 		return 1;
 
 	share_segment->ci_cache_modified = 0;
+
+	//ļеĴ¾˳
+	RebuildCiCache(CI_CACHE_SIZE);
+
 	if (!SaveToFile(ci_cache_file_name, &share_segment->ci_cache, sizeof(share_segment->ci_cache)))
 	{
 		Log(LOG_ID, L"Cacheʧܣfile:%s", ci_cache_file_name);
@@ -102,11 +273,13 @@ int LoadCiCacheData(const TCHAR *ci_cache_file_name)
 	if (length < 0)
 	{
 		share_segment->ci_cache.length = share_segment->ci_cache.max_used_id = 0;
+		BuildCiCacheIndex();
 		Log(LOG_ID, L"ȡCacheļfile:%s, length=%d", ci_cache_file_name, length);
 		return 0;
 	}
 
 	CheckAndUpgradeCiCache();
+	BuildCiCacheIndex();
 
 	share_segment->ci_cache_loaded = 1;
 	return 1;
@@ -120,34 +293,62 @@ int FreeCiCacheData()
 	return 1;
 }
 
-/*	ڴCacheҳʵλá
+/*	ڴCacheҳʡ
  *	
  *		hz			
  *		length		
  *	أ
  *		-1ûҵ
- *		>0 ôCacheеλãԽСԽ£
+ *		>0 ôCacheеıʶ¾˳ͨGetCiCacheStampã
  */
 int GetCiCacheInfo(HZ *hz, int length)
 {
-	int pos = 0;
-	int item_length = WORDLIB_FEATURE_LENGTH + sizeof(HZ) * length;
+	CICACHEINDEX *index = &share_segment->ci_cache_index;
+	int entry, pos;
 
-	//ʵcache
-	while(pos + item_length <= share_segment->ci_cache.length)		//ҪжһԽ
+	//ɢбͰ
+	for (entry = index->buckets[GetCiCacheHash(hz, length)]; entry; entry = index->entries[entry].hash_next)
 	{
+		pos = index->entries[entry].pos;
 		if ((char)share_segment->ci_cache.cache[pos] == (char)length &&										//ͬ
 			!memcmp(&share_segment->ci_cache.cache[pos + WORDLIB_FEATURE_LENGTH], hz, length * sizeof(HZ)))	//ͬ
-			return pos;
-
-		//һ
-		pos += WORDLIB_FEATURE_LENGTH + share_segment->ci_cache.cache[pos] * sizeof(HZ);
+			return entry;
 	}
 
 	//ûҵ
 	return -1;
 }
 
+/*	ѡм¼ĴCacheʶǷȻʣCacheʱ±ţʱ
+ *	²ҡ
+ *	
+ *		cache_pos	¼ıʶ-1ΪCache
+ *		hz			
+ *		length		
+ *	أ
+ *		-1ûҵ
+ *		>0 ôCacheеıʶ
+ */
+static int RevalidateCiCachePos(int cache_pos, HZ *hz, int length)
+{
+	CICACHEINDEX *index = &share_segment->ci_cache_index;
+	int pos;
+
+	if (cache_pos <= 0)
+		return cache_pos;
+
+	if (cache_pos <= index->entry_count)
+	{
+		pos = index->entries[cache_pos].pos;
+		if (pos + WORDLIB_FEATURE_LENGTH + length * (int)sizeof(HZ) <= share_segment->ci_cache.length &&
+			(char)share_segment->ci_cache.cache[pos] == (char)length &&
+			!memcmp(&share_segment->ci_cache.cache[pos + WORDLIB_FEATURE_LENGTH], hz, length * sizeof(HZ)))
+			return cache_pos;
+	}
+
+	return GetCiCacheInfo(hz, length);
+}
+
 /*	CacheʹöȵٽֵҪеĴʵʹöȼ١
  *	
  *	أ
@@ -181,11 +382,11 @@ void ReduceCiCacheUsedCount()
  */
 void InsertCiToCache(HZ *hz, int length, int syllable_length, int set_fix_top)
 {
+	int entry;						//CacheеĴʶ
 	int pos;						//Cacheеλ
 	int item_length;				//ĳ
 	int used_count;					//ʻʹö
 	int i;
-	char item_save[WORDLIB_FEATURE_LENGTH + sizeof(HZ) * MAX_WORD_LENGTH];		//ʱ
 
 	//Եǰλȷʵ˳Ƶ
 	if (pim_config->ci_option & CI_ADJUST_FREQ_NONE)
@@ -200,23 +401,39 @@ void InsertCiToCache(HZ *hz, int length, int syllable_length, int set_fix_top)
 
 	item_length = length * sizeof(HZ) + WORDLIB_FEATURE_LENGTH;
 
+	//CacheеʹöԼλýı䣬̼ĺѡʧЧ
+	share_segment->candidate_data_version++;
+
 	//ǷCache?
-	pos = GetCiCacheInfo(hz, length);
+	entry = GetCiCacheInfo(hz, length);
 
-	if (pos != -1)		//ҵ
+	if (entry != -1)		//ҵ
 	{
+		pos = share_segment->ci_cache_index.entries[entry].pos;
 		used_count = *(int*)&share_segment->ci_cache.cache[pos] >> 8;		//ҳʵʹö
 		used_count++;
 	}
-	else		//ûҵĻ뵽cacheĩβ
+	else		//ûҵĻ׷ӵcacheĩβ
 	{
+		//cacheȥɵĴ
+		if (share_segment->ci_cache.length + item_length > CI_CACHE_SIZE)
+			RebuildCiCache(CI_CACHE_SIZE - CI_MOVE_SIZE);
+
+		if (share_segment->ci_cache.length + item_length > CI_CACHE_SIZE)
+			return;
+
 		used_count = 1;
 		pos = share_segment->ci_cache.length;
-		share_segment->ci_cache.length	   = pos + item_length;
 		share_segment->ci_cache.cache[pos] = (char)length;
 
 		for (i = 0; i < (int)(length * sizeof(HZ)); i++)
 			share_segment->ci_cache.cache[pos + i + WORDLIB_FEATURE_LENGTH] = *((char*)hz + i);	//ֿCache
+
+		entry = NewCiCacheEntry(pos);
+		if (!entry)
+			return;
+
+		share_segment->ci_cache.length = pos + item_length;
 	}
 
 	if (set_fix_top)
@@ -226,21 +443,8 @@ void InsertCiToCache(HZ *hz, int length, int syllable_length, int set_fix_top)
 
 	*(int*)&share_segment->ci_cache.cache[pos] = (used_count << 8) + share_segment->ci_cache.cache[pos];	//ʹö
 
-	//˳
-	//(0)(1)....(pos-1)(pos)(pos+1)...(cache_length-1)  ====> (pos)(0)(1)...(pos-1)(pos+1)...(cache_length-1)
-	//浱ǰ
-	for (i = 0; i < item_length; i++)
-		item_save[i] = share_segment->ci_cache.cache[pos + i];
-
-	for (i = pos - 1; i >= 0; i--)
-		share_segment->ci_cache.cache[i + item_length] = share_segment->ci_cache.cache[i];
-
-	for (i = 0; i < item_length; i++)
-		share_segment->ci_cache.cache[i] = item_save[i];
-
-	//ԽĴCacheȼٻ
-	if (share_segment->ci_cache.length > CI_CACHE_SIZE)
-		share_segment->ci_cache.length = CI_CACHE_SIZE;
+	//˳򣬳ΪµĴ
+	MoveCiCacheEntryToHead(entry);
 
 	//ʹöԽ磬Ҫдʹöȼ
 	if (used_count > CI_MAX_USED_COUNT)
@@ -254,10 +458,20 @@ void InsertCiToCache(HZ *hz, int length, int syllable_length, int set_fix_top)
  */
 int GetCiUsedCount(int cache_pos)
 {
-	if (cache_pos < 0)
+	if (cache_pos <= 0 || cache_pos > share_segment->ci_cache_index.entry_count)
+		return 0;
+
+	return *(int*)&share_segment->ci_cache.cache[share_segment->ci_cache_index.entries[cache_pos].pos] >> 8;
+}
+
+/**	شʵʹţԽԽ
+ */
+unsigned int GetCiCacheStamp(int cache_pos)
+{
+	if (cache_pos <= 0 || cache_pos > share_segment->ci_cache_index.entry_count)
 		return 0;
 
-	return *(int*)&share_segment->ci_cache.cache[cache_pos] >> 8;
+	return share_segment->ci_cache_index.entries[cache_pos].stamp;
 }
 
 /*	ȽϴеĺԼƵڴʵĺѡ˳
@@ -286,10 +500,11 @@ static int CompareCi(const CANDIDATE *cand1, const CANDIDATE *cand2)
 	//رעCiCacheZiCacheṹܴcache_posҲͬ
 	//Ķ䶨
 
+	//ʹöԼʹǰѾȡSortCiCandidatesÿαȽ϶Cache
 	cache_pos1  = cand1->word.cache_pos;
 	cache_pos2  = cand2->word.cache_pos;
-	used_count1 = GetCiUsedCount(cache_pos1);
-	used_count2 = GetCiUsedCount(cache_pos2);
+	used_count1 = cand1->word.used_count;
+	used_count2 = cand2->word.used_count;
 
 	if (CI_TOP_USED_COUNT == used_count1 && CI_TOP_USED_COUNT != used_count2)
 		return -1;
@@ -313,8 +528,8 @@ static int CompareCi(const CANDIDATE *cand1, const CANDIDATE *cand2)
 			if (cache_pos2 == -1)
 				return -1;
 
-			//Cacheλÿǰǰ
-			return cache_pos1 - cache_pos2;
+			//Cacheнµǰ
+			return cand1->word.cache_stamp > cand2->word.cache_stamp ? -1 : 1;
 		}
 	}
 
@@ -338,41 +553,149 @@ static int CompareCi(const CANDIDATE *cand1, const CANDIDATE *cand2)
 	return cand2->word.item->freq - cand1->word.item->freq;
 }
 
-/*	ȽϴеĺԼƵڴʵ
+//ʺѡҡءʱѡṹѡṹаʵԼ֣
+//ȴʺѡöࣩźôɴʺѡʿװغλò䣬ֱʹôָ롣
+typedef struct tagCIHANDLE
+{
+	WORDLIBITEM			*item;				//
+	short				source;				//ʻԴʿʶ
+	short				type;				//ʺѡ
+	int					cache_pos;			//ڴCacheеλ
+	int					order;				//ԭĴ򣨼ֵͬʱԭĴ
+	unsigned __int64	sort_key;			//ֵԽԽǰ
+}CIHANDLE;
+
+/*	ʺѡֵֵǰ棬CompareCiͬӸλλΪ
+ *	öʣ1λǷCacheУ1λƵʱʹãCacheеʹŻʹö
+ *	32λٵƵʱΪʹţٵʱΪʹöȣƵ19λ
  *	
- *		cand1, cand2		ڱȽϵѡָ
+ *		item			
+ *		cache_pos		ڴCacheеλã-1ΪCache
  *	أ
- *		һȵڶС <0
- *		һڵڶ =0
- *		һڵڶ >0
+ *		ֵ
  */
-static int CompareCiCodeFreq(const CANDIDATE *cand1, const CANDIDATE *cand2)
+static unsigned __int64 GetCiSortKey(WORDLIBITEM *item, int cache_pos)
 {
-	int ret;
+	unsigned __int64 key = item->freq;
+	int used_count = GetCiUsedCount(cache_pos);
 
-	assert(cand1 && cand2);
+	if (CI_TOP_USED_COUNT == used_count)
+		key |= (unsigned __int64)1 << 63;
 
-	//Ȳͬ
-	if (cand1->word.item->ci_length != cand2->word.item->ci_length)
-		return cand2->word.item->ci_length - cand1->word.item->ci_length;
+	if (!(pim_config->ci_option & (CI_ADJUST_FREQ_FAST | CI_ADJUST_FREQ_SLOW)) || cache_pos == -1)
+		return key;
 
-	//ʵֲͬ򷵻ʵ
-	ret = memcmp(cand2->word.hz, cand1->word.hz, sizeof(HZ) * cand1->word.item->ci_length);
-	if (ret)
-		return ret;
+	key |= (unsigned __int64)1 << 62;
 
-	//һǱɾģǰ
-	if (cand1->word.item->effective && !cand2->word.item->effective)
-		return 1;
+	//ʹöȼΪתΪ޷ʱִС
+	if (pim_config->ci_option & CI_ADJUST_FREQ_FAST)
+		key |= (unsigned __int64)GetCiCacheStamp(cache_pos) << 19;
+	else
+		key |= (unsigned __int64)((unsigned int)used_count ^ 0x80000000) << 19;
 
-	if (cand2->word.item->effective && !cand1->word.item->effective)
-		return -1;
+	return key;
+}
 
-	//ȽƵ
-	return cand2->word.item->freq - cand1->word.item->freq;
+/*	ȽʺѡֵͬʱԭĴ
+ */
+static int CompareCiHandle(const CIHANDLE *handle1, const CIHANDLE *handle2)
+{
+	if (handle1->sort_key != handle2->sort_key)
+		return handle1->sort_key > handle2->sort_key ? -1 : 1;
+
+	return handle1->order - handle2->order;
+}
+
+/*	ʱʹõĶѣΪѡľһ
+ */
+static void SiftCiHandleHeap(CIHANDLE *heap, int heap_count, int pos)
+{
+	CIHANDLE temp;
+	int child;
+
+	while ((child = pos * 2 + 1) < heap_count)
+	{
+		if (child + 1 < heap_count && CompareCiHandle(&heap[child + 1], &heap[child]) > 0)
+			child++;
+
+		if (CompareCiHandle(&heap[child], &heap[pos]) <= 0)
+			break;
+
+		temp		= heap[pos];
+		heap[pos]	= heap[child];
+		heap[child] = temp;
+		pos			= child;
+	}
 }
 
-/*	Դʽ
+/*	ԴʺѡֻȽϾеļֵcandidate_top_countΪ0Ҿ϶ʱ
+ *	ֻǰcandidate_top_countѡŵǰĴȷ
+ *	
+ *		handles			ʺѡorderԼsort_keyѾã
+ *		count			Ŀ
+ *	أ
+ *		źôľĿ
+ */
+static int SortCiHandles(CIHANDLE *handles, int count)
+{
+	CIHANDLE temp;
+	int top_count = candidate_top_count;
+	int i;
+
+	if (!top_count || count <= top_count)
+	{
+		qsort(handles, count, sizeof(CIHANDLE), (int (*)(const void*, const void*))CompareCiHandle);
+		return count;
+	}
+
+	//ǰtop_countɶѣľȶѵĸǰʱ
+	for (i = top_count / 2 - 1; i >= 0; i--)
+		SiftCiHandleHeap(handles, top_count, i);
+
+	for (i = top_count; i < count; i++)
+	{
+		if (CompareCiHandle(&handles[i], &handles[0]) >= 0)
+			continue;
+
+		temp	   = handles[0];
+		handles[0] = handles[i];
+		handles[i] = temp;
+		SiftCiHandleHeap(handles, top_count, 0);
+	}
+
+	qsort(handles, top_count, sizeof(CIHANDLE), (int (*)(const void*, const void*))CompareCiHandle);
+
+	return top_count;
+}
+
+/*	ɴʺѡɾ
+ */
+static void MakeCiHandle(CIHANDLE *handle, const CANDIDATE *candidate, int order)
+{
+	handle->item	  = candidate->word.item;
+	handle->source	  = (short)candidate->word.source;
+	handle->type	  = (short)candidate->word.type;
+	handle->cache_pos = candidate->word.cache_pos;
+	handle->order	  = order;
+	handle->sort_key  = 0;
+}
+
+/*	ɾɴʺѡ
+ */
+static void MakeCiCandidate(CANDIDATE *candidate, const CIHANDLE *handle)
+{
+	candidate->type			  = CAND_TYPE_CI;
+	candidate->word.type	  = handle->type;
+	candidate->word.source	  = handle->source;
+	candidate->word.item	  = handle->item;
+	candidate->word.cache_pos = handle->cache_pos;
+	candidate->word.syllable  = GetItemSyllablePtr(handle->item);
+	candidate->word.hz		  = GetItemHZPtr(handle->item);
+}
+
+/*	Դʽcandidate_top_countΪ0ʱֻ֤ǰĺѡ
+ *	ھϽУԤȼֵźúÿѡֻƶһΡ
+ *	ѡڴCache֮ǰãǰȷеĴCacheʶ
  *	
  *		candidates		ʺѡ
  *		count			ѡ
@@ -380,54 +703,192 @@ static int CompareCiCodeFreq(const CANDIDATE *cand1, const CANDIDATE *cand2)
  */
 void SortCiCandidates(CANDIDATE *candidates, int count)
 {
+	TEMPMEMORYMARK mark = GetTempMemoryMark();
+	CIHANDLE *handles;
+	CANDIDATEHANDLE *order;
+	int sorted_count, ok = 0;
+	int i;
+
 	if (count < 2)
 		return;
 
-	qsort(candidates, count, sizeof(CANDIDATE), CompareCi);
+	for (i = 0; i < count; i++)
+		candidates[i].word.cache_pos = RevalidateCiCachePos(candidates[i].word.cache_pos, candidates[i].word.hz, candidates[i].word.item->ci_length);
+
+	handles = AllocateTempMemory(sizeof(CIHANDLE) * count);
+	order	= AllocateTempMemory(sizeof(CANDIDATEHANDLE) * count);
+	if (handles && order)
+	{
+		for (i = 0; i < count; i++)
+		{
+			MakeCiHandle(&handles[i], &candidates[i], i);
+			handles[i].sort_key = GetCiSortKey(handles[i].item, handles[i].cache_pos);
+		}
+
+		sorted_count = SortCiHandles(handles, count);
+		for (i = 0; i < sorted_count; i++)
+			order[i] = handles[i].order;
+
+		if (sorted_count < count)
+			ok = ArrangeTopCandidates(candidates, order, sorted_count);
+		else
+			ok = ArrangeCandidates(candidates, order, count);
+	}
+
+	FreeTempMemory(mark);
+
+	if (ok)
+		return;
+
+	//ʱڴ治ʱʹñȽϺֱӶԺѡ
+	for (i = 0; i < count; i++)
+	{
+		candidates[i].word.used_count  = GetCiUsedCount(candidates[i].word.cache_pos);
+		candidates[i].word.cache_stamp = GetCiCacheStamp(candidates[i].word.cache_pos);
+	}
+
+	PartialSortCandidates(candidates, count, CompareCi);
+}
+
+//ɢбĴСѡĿʱʹջϵı
+#define	CI_UNIFY_HASH_SIZE			0x2000
+
+/**	õĴɢֵ
+ */
+static unsigned int GetCiUnifyHash(HZ *hz, int length)
+{
+	unsigned int value = length;
+	int i;
+
+	for (i = 0; i < length; i++)
+		value = value * 31 + hz[i];
+
+	return value;
 }
 
-/*	ʺѡء
+/*	ʺѡء
+ *	ʹÿŶַɢбһɣͬһʣֻͬһɾĴ
+ *	ȥαƵߵġغ״γֵ˳ɵ
  *	
- *		candidates			ʺѡ
- *		count				鳤
+ *		handles				ʺѡ
+ *		count				Ŀ
  *	أ
- *		غĺѡĿ
+ *		غľĿ
  */
-int UnifyCiCandidates(CANDIDATE *candidates, int count)
+static int UnifyCiHandles(CIHANDLE *handles, int count)
 {
-	int new_count, i;
+	short hash_buffer[CI_UNIFY_HASH_SIZE];
+	int *hash_table = 0;
+	TEMPMEMORYMARK mark = GetTempMemoryMark();
+	WORDLIBITEM *item, *old_item;
+	int new_count = 0, hash_size, pos, k, i;
 
-	if (!count)		//´ʲ
+	if (!count)
 		return count;
 
-	//hz˳ͬĴʻ㽫һλ
-	qsort(candidates, count, sizeof(CANDIDATE), CompareCiCodeFreq);
+	for (hash_size = 16; hash_size < count * 2; hash_size <<= 1)
+		;
 
-	//
-	for (new_count = 1, i = 1; i < count; i++)
+	if (hash_size > CI_UNIFY_HASH_SIZE)
+	{
+		hash_table = AllocateTempMemory(sizeof(int) * hash_size);
+		if (!hash_table)
+			return count;
+
+		memset(hash_table, -1, sizeof(int) * hash_size);
+	}
+	else
+		memset(hash_buffer, -1, sizeof(short) * hash_size);
+
+	for (i = 0; i < count; i++)
 	{
-		if (candidates[i].word.item->ci_length == candidates[i - 1].word.item->ci_length &&
-			!memcmp(candidates[i].word.hz, candidates[i - 1].word.hz, sizeof(HZ) * candidates[i].word.item->ci_length))
+		item = handles[i].item;
+		pos	 = GetCiUnifyHash(GetItemHZPtr(item), item->ci_length) & (hash_size - 1);
+
+		//ҳͬĴʻ߿λ
+		for (;;)
+		{
+			k = hash_table ? hash_table[pos] : hash_buffer[pos];
+			if (k == -1)
+				break;
+
+			old_item = handles[k].item;
+			if (old_item->ci_length == item->ci_length &&
+				!memcmp(GetItemHZPtr(old_item), GetItemHZPtr(item), sizeof(HZ) * item->ci_length))
+				break;
+
+			pos = (pos + 1) & (hash_size - 1);
+		}
+
+		if (k != -1)		//ظĴʣȵһɾĴȣΪƵߵģ
+		{
+			old_item = handles[k].item;
+			if ((old_item->effective && !item->effective) ||
+				(old_item->effective == item->effective && item->freq > old_item->freq))
+				handles[k] = handles[i];
+
 			continue;
+		}
 
-		candidates[new_count] = candidates[i];
-		new_count++;
+		if (hash_table)
+			hash_table[pos] = new_count;
+		else
+			hash_buffer[pos] = (short)new_count;
+
+		handles[new_count++] = handles[i];
 	}
 
+	FreeTempMemory(mark);
+
 	count = new_count;
 
 	//ɾѾɾĴʻ
 	for (new_count = 0, i = 0; i < count; i++)
 	{
-		if (!candidates[i].word.item->effective)	//ҵɾĴ
+		if (!handles[i].item->effective)	//ҵɾĴ
 			continue;
 
-		candidates[new_count++] = candidates[i];
+		handles[new_count++] = handles[i];
 	}
 
 	return new_count;
 }
 
+/*	ʺѡءھأĺѡԭĴֻƶһΡ
+ *	
+ *		candidates			ʺѡ
+ *		count				鳤
+ *	أ
+ *		غĺѡĿ
+ */
+int UnifyCiCandidates(CANDIDATE *candidates, int count)
+{
+	TEMPMEMORYMARK mark = GetTempMemoryMark();
+	CIHANDLE *handles;
+	int new_count, i;
+
+	if (!count)
+		return count;
+
+	handles = AllocateTempMemory(sizeof(CIHANDLE) * count);
+	if (!handles)
+		return count;
+
+	for (i = 0; i < count; i++)
+		MakeCiHandle(&handles[i], &candidates[i], i);
+
+	new_count = UnifyCiHandles(handles, count);
+
+	//ľԭĴСڵλãҺľõǰλ
+	for (i = 0; i < new_count; i++)
+		if (handles[i].order != i)
+			candidates[i] = candidates[handles[i].order];
+
+	FreeTempMemory(mark);
+
+	return new_count;
+}
+
 /*	һʵָ롣
  *	
  *		item		ǰָ
@@ -473,44 +934,120 @@ int GetItemLength(int hz_length, int syllable_length)
 	return sizeof(HZ) * hz_length + sizeof(SYLLABLE) * syllable_length + WORDLIB_FEATURE_LENGTH;
 }
 
-/*	ҳеĴʺѡûͨ
+/**	УֻȽĸĸȽȽڣڱʿԼҡ
+ *	أ
+ *		<0һǰ0ͬ>0һں
+ */
+int CompareSyllableKey(const SYLLABLE *syllable1, int length1, const SYLLABLE *syllable2, int length2)
+{
+	int i;
+
+	for (i = 0; i < length1 && i < length2; i++)
+	{
+		if (syllable1[i].con != syllable2[i].con)
+			return syllable1[i].con - syllable2[i].con;
+
+		if (syllable1[i].vow != syllable2[i].vow)
+			return syllable1[i].vow - syllable2[i].vow;
+	}
+
+	return length1 - length2;
+}
+
+/*	ҳֵеĹڳԼǰڿܵĸ
+ *	ģz/zhl/nԼ˫ƴĶֽʹһڿжĸֻȽЩ
+ *	ĸжͬλ˼ֵֻ©
  *	
- *		page					ҳָ
  *		syllable_array			
  *		syllable_count			ڳ
- *		candidate_array			ѡ
- *		candidate_length		ѡ鳤
  *		fuzzy_mode				ģѡ
- *	أ
- *		ѡʻĿ
+ *		key_mask				ֵ루
+ *		key_value				ֵ
+ *	أ
  */
-int GetCiInPage(PAGE *page,	SYLLABLE *syllable_array, int syllable_count, CANDIDATE *candidate_array, int candidate_length,	int fuzzy_mode)
+static void GetCiPageKey(SYLLABLE *syllable_array, int syllable_count, int fuzzy_mode, unsigned int *key_mask, unsigned int *key_value)
 {
-	WORDLIBITEM *item;				//
-	int count = 0;					//ѡ
+	unsigned int letters, same_bits;
+	int code, first_code, i, shift;
 
-	if (!candidate_length)
-		return 0;
-
-	//ҳûаȵĴʣֱӷأΪ߼Чʣ
-	if (!(page->length_flag & (1 << syllable_count)))
-		return 0;
+	//жϳǷ
+	*key_mask  = WORDLIB_KEY_LENGTH_MASK;
+	*key_value = syllable_count;
+	if (!(fuzzy_mode & FUZZY_CI_SYLLABLE_LENGTH))
+	{
+		*key_mask  |= WORDLIB_KEY_SAME_LENGTH;
+		*key_value |= WORDLIB_KEY_SAME_LENGTH;
+	}
 
-	//ҳ
-	for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+	//ĸ
+	for (i = 0; i < WORDLIB_KEY_LETTER_COUNT && i < syllable_count; i++)
 	{
-		if (!(fuzzy_mode & FUZZY_CI_SYLLABLE_LENGTH))
-			if (item->ci_length != item->syllable_length)
+		letters = GetSyllableFirstLetters(syllable_array[i], fuzzy_mode);
+		if (!letters)
+			continue;
+
+		same_bits  = WORDLIB_KEY_LETTER_MASK;
+		first_code = -1;
+		for (code = 0; code <= 'z' - 'a' + 1; code++)
+		{
+			if (!((letters >> code) & 1))
 				continue;
 
-		//жϳǷ
-		if (item->syllable_length != syllable_count)
-			continue;
+			if (first_code < 0)
+				first_code = code;
+			else
+				same_bits &= ~(code ^ first_code);
+		}
+
+		shift		= WORDLIB_KEY_LETTER_SHIFT + i * WORDLIB_KEY_LETTER_BITS;
+		*key_mask  |= same_bits << shift;
+		*key_value |= (first_code & same_bits) << shift;
+	}
+}
+
+/*	ҳеĴʺѡûͨ
+ *	ͨҳֵڳĸֻԷϵĴڱȽϡ
+ *	
+ *		wordlib_id				ʿʶ
+ *		page					ҳָ
+ *		syllable_array			
+ *		syllable_count			ڳ
+ *		candidate_array			ѡ
+ *		candidate_length		ѡ鳤
+ *		fuzzy_mode				ģѡ
+ *		key_mask				ҳֵ루GetCiPageKey
+ *		key_value				ҳֵGetCiPageKey
+ *	أ
+ *		ѡʻĿ
+ */
+int GetCiInPage(int wordlib_id, PAGE *page, SYLLABLE *syllable_array, int syllable_count, CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode,
+				unsigned int key_mask, unsigned int key_value)
+{
+	WORDLIBITEM *items[WORDLIB_PAGE_MAX_ITEMS];		//ֵϵĴ
+	WORDLIBITEM *item;				//
+	int item_count, i;
+	int count = 0;					//ѡ
+
+	if (!candidate_length)
+		return 0;
+
+	//ҳûаȵĴʣֱӷأΪ߼Чʣ
+	if (!(page->length_flag & (1 << syllable_count)))
+		return 0;
+
+	item_count = GetWordLibPageItems(wordlib_id, page, key_mask, key_value, items);
+	for (i = 0; i < item_count; i++)
+	{
+		item = items[i];
 
 		//жǷ
 		if (!CompareSyllables(syllable_array, item->syllable, syllable_count, fuzzy_mode))
 			continue;
 
+		//жǷ
+		if ((fuzzy_mode & FUZZY_CI_TONE) && !CiContainTone(syllable_array, syllable_count, item, 0))
+			continue;
+
 		//ҵ!
 		candidate_array[count].word.type	  = CI_TYPE_NORMAL;
 		candidate_array[count].word.item	  = item;
@@ -570,6 +1107,10 @@ int GetCiInPageWild(PAGE *page,	SYLLABLE *syllable_array, int syllable_count, CA
 		if (!WildCompareSyllables(syllable_array, syllable_count, item->syllable, item->syllable_length, fuzzy_mode))
 			continue;
 
+		//жǷ
+		if ((fuzzy_mode & FUZZY_CI_TONE) && !CiContainTone(syllable_array, syllable_count, item, 1))
+			continue;
+
 		//ҵ!
 		candidate_array[count].word.type	  = CI_TYPE_NORMAL;
 		candidate_array[count].word.item	  = item;
@@ -586,19 +1127,23 @@ int GetCiInPageWild(PAGE *page,	SYLLABLE *syllable_array, int syllable_count, CA
 }
 
 /*	ʹĸҳеĴʺѡûͨ
+ *	ҳֵаڳԼǰڵĸֻԷϵĴȽĸ
  *	
+ *		wordlib_id				ʿʶ
  *		page					ҳָ
  *		letters					
  *		letter_count			ڳ
  *		candidate_array			ѡ
  *		candidate_length		ѡ鳤
- *		fuzzy_mode				ģѡ
  *	أ
  *		ѡʻĿ
  */
-int GetCiInPageByLetter(PAGE *page, const TCHAR *letters, int letter_count, CANDIDATE *candidate_array, int candidate_length)
+int GetCiInPageByLetter(int wordlib_id, PAGE *page, const TCHAR *letters, int letter_count, CANDIDATE *candidate_array, int candidate_length)
 {
+	WORDLIBITEM *items[WORDLIB_PAGE_MAX_ITEMS];		//ֵϵĴ
 	WORDLIBITEM *item;				//
+	unsigned int key_mask, key_value;
+	int item_count, i, shift;
 	int count = 0;					//ѡ
 
 	if (!candidate_length || !letters)
@@ -608,15 +1153,23 @@ int GetCiInPageByLetter(PAGE *page, const TCHAR *letters, int letter_count, CAND
 	if (!(page->length_flag & (1 << letter_count)))
 		return 0;
 
-	//ҳ
-	for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+	//Լǰĸ
+	key_mask  = WORDLIB_KEY_LENGTH_MASK;
+	key_value = letter_count;
+	for (i = 0; i < WORDLIB_KEY_LETTER_COUNT && i < letter_count; i++)
 	{
-		//жϳǷ
-		if (letter_count != item->syllable_length)
-			continue;
+		shift	   = WORDLIB_KEY_LETTER_SHIFT + i * WORDLIB_KEY_LETTER_BITS;
+		key_mask  |= WORDLIB_KEY_LETTER_MASK << shift;
+		key_value |= (letters[i] - 'a' + 1) << shift;
+	}
+
+	item_count = GetWordLibPageItems(wordlib_id, page, key_mask, key_value, items);
+	for (i = 0; i < item_count; i++)
+	{
+		item = items[i];
 
 		//жǷ
-		if (!CompareSyllablesAndLetters(letters, item->syllable, letter_count))
+		if (letter_count > WORDLIB_KEY_LETTER_COUNT && !CompareSyllablesAndLetters(letters, item->syllable, letter_count))
 			continue;
 
 		//ҵ!
@@ -690,6 +1243,113 @@ int GetCiInPageByWildLetter(PAGE *page, const TCHAR *letters, int letter_count,
 	return count;
 }
 
+//ʿУǰϳĿʱֱӱҳ
+#define	COMPILED_MAX_KEY_COUNT			256
+
+/*	ڱʿлôʻѡûͨ
+ *	öǰݵȫڣģƫƱжֲ
+ *	Ӧ䣬ֻڵĴаȵĴʣmin_countСsyllable_count
+ *	ʱһεõиǰ׺Ĵʡ
+ *	
+ *		wordlib_id				ʿʶ
+ *		wordlib					ʿָ
+ *		syllable_array			
+ *		syllable_count			ڳ
+ *		min_count				ʵСڳ
+ *		candidate_array			ѡ
+ *		candidate_length		ѡ鳤
+ *		fuzzy_mode				ģѡ
+ *	أ
+ *		ѡʻĿ
+ *		-1Ϲ࣬Ҫҳ
+ */
+static int GetCiInCompiledWordLib(int wordlib_id, WORDLIB *wordlib, SYLLABLE *syllable_array, int syllable_count, int min_count,
+								  CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode)
+{
+	SYLLABLE first[CON_END * VOW_END], second[CON_END * VOW_END], key[2], syllable_tmp;
+	int *sorted_index = (int*)((char*)wordlib + wordlib->header.sorted_index_pos);
+	int first_count = 0, second_count = 0;
+	int count = 0;
+	int i, j, low, high, mid, length;
+	WORDLIBITEM *item;
+
+	syllable_tmp.tone = TONE_0;
+
+	//ҳǰݵȫ
+	for (i = CON_NULL; i < CON_END; i++)
+		for (j = VOW_NULL; j < VOW_END; j++)
+		{
+			syllable_tmp.con = i;
+			syllable_tmp.vow = j;
+
+			if (ContainSyllable(syllable_array[0], syllable_tmp, fuzzy_mode))
+				first[first_count++] = syllable_tmp;
+
+			if (ContainSyllable(syllable_array[1], syllable_tmp, fuzzy_mode))
+				second[second_count++] = syllable_tmp;
+		}
+
+	if (first_count * second_count > COMPILED_MAX_KEY_COUNT)
+		return -1;
+
+	for (i = 0; i < first_count && count < candidate_length; i++)
+	{
+		for (j = 0; j < second_count && count < candidate_length; j++)
+		{
+			key[0] = first[i];
+			key[1] = second[j];
+
+			//ֲҵһСkeyĴ
+			low  = 0;
+			high = wordlib->header.sorted_item_count;
+			while (low < high)
+			{
+				mid  = (low + high) / 2;
+				item = (WORDLIBITEM*)((char*)wordlib + sorted_index[mid]);
+
+				if (CompareSyllableKey(item->syllable, 2, key, 2) < 0)
+					low = mid + 1;
+				else
+					high = mid;
+			}
+
+			//ǰͬ
+			for (; low < wordlib->header.sorted_item_count && count < candidate_length; low++)
+			{
+				item = (WORDLIBITEM*)((char*)wordlib + sorted_index[low]);
+				if (CompareSyllableKey(item->syllable, 2, key, 2))
+					break;
+
+				if (!(fuzzy_mode & FUZZY_CI_SYLLABLE_LENGTH))
+					if (item->ci_length != item->syllable_length)
+						continue;
+
+				length = item->syllable_length;
+				if (length < min_count || length > syllable_count)
+					continue;
+
+				if (!CompareSyllables(syllable_array, item->syllable, length, fuzzy_mode))
+					continue;
+
+				if ((fuzzy_mode & FUZZY_CI_TONE) && !CiContainTone(syllable_array, length, item, 0))
+					continue;
+
+				candidate_array[count].type			  = CAND_TYPE_CI;
+				candidate_array[count].word.type	  = CI_TYPE_NORMAL;
+				candidate_array[count].word.source	  = wordlib_id;
+				candidate_array[count].word.item	  = item;
+				candidate_array[count].word.cache_pos = 0;
+				candidate_array[count].word.syllable  = GetItemSyllablePtr(item);
+				candidate_array[count].word.hz		  = GetItemHZPtr(item);
+
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
 /*	ôʻѡ
  *	
  *		wordlib_id				ʿʶ
@@ -709,6 +1369,7 @@ int GetCiCandidates(int wordlib_id, SYLLABLE *syllable_array, int syllable_count
 	int i, j;
 	SYLLABLE syllable_tmp1, syllable_tmp2;
 	int wild_compare = 0;								//ǷʹͨȽ
+	unsigned int key_mask = 0, key_value = 0;			//ҳֵĹ
 
 	if (!candidate_length || wordlib_id < 0)
 		return 0;
@@ -728,6 +1389,23 @@ int GetCiCandidates(int wordlib_id, SYLLABLE *syllable_array, int syllable_count
 
 	wild_compare = i != syllable_count;
 
+	//ʿ⣬ʹƫƱв
+	if (!wild_compare && IsCompiledWordLibrary(wordlib))
+	{
+		count = GetCiInCompiledWordLib(wordlib_id, wordlib, syllable_array, syllable_count, syllable_count, candidate_array, candidate_length, fuzzy_mode);
+		if (count >= 0)
+			return count;
+	}
+
+	//ʹôʿвңֻݵ
+	count = GetCiInWordLibIndex(wordlib_id, syllable_array, syllable_count, candidate_array, candidate_length, fuzzy_mode, wild_compare);
+	if (count >= 0)
+		return count;
+
+	count = 0;
+	if (!wild_compare)
+		GetCiPageKey(syllable_array, syllable_count, fuzzy_mode, &key_mask, &key_value);
+
 	//ڱȽϵʱڳʼ
 	syllable_tmp1.con  = syllable_tmp2.con  = CON_NULL;
 	syllable_tmp1.vow  = syllable_tmp2.vow  = VOW_NULL;
@@ -764,12 +1442,15 @@ int GetCiCandidates(int wordlib_id, SYLLABLE *syllable_array, int syllable_count
 							fuzzy_mode)
 					:
 						GetCiInPage(				//ʹͨ
+							wordlib_id,
 							&wordlib->pages[page_no],
 							syllable_array,
 							syllable_count,
 							candidate_array + count,
 							candidate_length - count,
-							fuzzy_mode);
+							fuzzy_mode,
+							key_mask,
+							key_value);
 
 				if (count >= candidate_length)
 					break;
@@ -792,6 +1473,40 @@ int GetCiCandidates(int wordlib_id, SYLLABLE *syllable_array, int syllable_count
 	return count;
 }
 
+/*	һλиǰ׺min_countsyllable_countڣĴʻѡͬһȵĴ
+ *	GetCiCandidatesĴֻͬʹñʿƫƱԼʿ
+ *	
+ *		wordlib_id				ʿʶ
+ *		syllable_array			Уͨ
+ *		syllable_count			ǰ׺
+ *		min_count				ǰ׺
+ *		candidate_array			ѡ
+ *		candidate_length		ѡ鳤
+ *		fuzzy_mode				ģѡ
+ *	أ
+ *		ѡʻĿ
+ *		-1һβңҪճȷֱ
+ */
+static int GetCiPrefixCandidates(int wordlib_id, SYLLABLE *syllable_array, int syllable_count, int min_count,
+								 CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode)
+{
+	WORDLIB *wordlib;
+	int count;
+
+	wordlib = GetWordLibrary(wordlib_id);
+	if (!wordlib)
+		return 0;
+
+	if (IsCompiledWordLibrary(wordlib))
+	{
+		count = GetCiInCompiledWordLib(wordlib_id, wordlib, syllable_array, syllable_count, min_count, candidate_array, candidate_length, fuzzy_mode);
+		if (count >= 0)
+			return count;
+	}
+
+	return GetCiPrefixesInWordLibIndex(wordlib_id, syllable_array, syllable_count, min_count, candidate_array, candidate_length, fuzzy_mode);
+}
+
 /*	ôʻѡ
  *	
  *		wordlib_id				ʿʶ
@@ -834,6 +1549,16 @@ int GetCiCandidatesByLetter(int wordlib_id, const TCHAR *letters, CANDIDATE *can
 	if (!wordlib)				//ûʿ
 		return 0;
 
+	//ʹĸֱӲ
+	if (!wild_compare)
+	{
+		count = GetCiInWordLibLetterIndex(wordlib_id, letters, length, candidate_array, candidate_length);
+		if (count >= 0)
+			return count;
+
+		count = 0;
+	}
+
 	//ĸıҳȫȷĸ
 	for (i = CON_NULL; i < CON_END; i++)
 	{
@@ -873,6 +1598,7 @@ int GetCiCandidatesByLetter(int wordlib_id, const TCHAR *letters, CANDIDATE *can
 									candidate_array + count,
 									candidate_length - count)
 							:	GetCiInPageByLetter(				//ʹͨ
+									wordlib_id,
 									&wordlib->pages[page_no],
 									letters,
 									length,
@@ -912,97 +1638,421 @@ void ProcessCiSelected(SYLLABLE *syllable, int syllable_length, HZ *hz, int hz_l
 	InsertCiToCache(hz, hz_length, syllable_length, 0);
 }
 
-/*	ɾȷĴʡ
+/*	жϴǷڵҪڴʿʱʹãģѡFUZZY_CI_TONE
  *	һʿеĴʶҪֵķ顣
  *	磺z4f ܹĴʰֲû˱
  *
  *	
  *		syllable_array			
  *		syllable_count			ڼ
- *		candidate_array			ѡ
- *		candidate_count			ѡĿ
+ *		item					
+ *		wild_compare			Ƿͨ
  *	أ
- *		ʣѡĿ
+ *		ϣ1
+ *		ϣ0
  */
-int DeleteCiCandidateByTone(SYLLABLE *syllable_array, int syllable_count, CANDIDATE *candidate_array, int candidate_count)
+int CiContainTone(SYLLABLE *syllable_array, int syllable_count, WORDLIBITEM *item, int wild_compare)
 {
-	int i, j;
-	int new_count = 0;
-	int has_tone = 0, has_wild = 0;
+	SYLLABLE *syllable = GetItemSyllablePtr(item);
+	HZ *hz = GetItemHZPtr(item);
+	int i;
+
+	if (wild_compare)
+		return WildCompareSyllablesWithCi(syllable_array, syllable_count, syllable, hz, item->syllable_length, 0);
 
-	//Ƿ
 	for (i = 0; i < syllable_count; i++)
+		if (syllable_array[i].tone != TONE_0 && !ZiContainTone(hz[i], syllable[i], syllable_array[i].tone))
+			return 0;
+
+	return 1;
+}
+
+//ƥеƬ
+typedef struct tagCILATTICESPAN
+{
+	SYLLABLE	syllable[MAX_WORD_LENGTH];		//Ƭε
+	int			syllable_count;					//Ŀ
+	int			fuzzy_mode;						//ģʽ
+	int			complete;						//ǷΪȫƥĴʣʱѡû
+	int			word_start;						//ڴʱеĿʼλ
+	int			word_count;						//Ŀ
+	int			next;							//ɢбͬһͰеһƬΣ-1Ϊ
+}CILATTICESPAN;
+
+//ƥеĴ
+typedef struct tagCILATTICEWORD
+{
+	WORDLIBITEM	*item;							//
+	int			source;							//ʿʶ
+}CILATTICEWORD;
+
+static CILATTICESPAN	ci_lattice_spans[CI_LATTICE_MAX_SPANS];
+static CILATTICEWORD	ci_lattice_words[CI_LATTICE_MAX_WORDS];
+static int				ci_lattice_buckets[CI_LATTICE_HASH_SIZE];
+static int				ci_lattice_span_count = 0;
+static int				ci_lattice_word_count = 0;
+static int				ci_lattice_ready	  = 0;		//ɢбǷѾʼ
+static int				ci_lattice_version	  = 0;		//ƥʱĺѡ޸ļ
+static int				ci_lattice_wildcard	  = 0;		//ƥʱǷͨ
+static int				ci_lattice_pinyin_mode = 0;		//ƥʱƴʽ˫ƴжģ
+
+/*	ƥ
+ */
+static void ClearCiLattice()
+{
+	memset(ci_lattice_buckets, -1, sizeof(ci_lattice_buckets));
+	ci_lattice_span_count = 0;
+	ci_lattice_word_count = 0;
+	ci_lattice_ready	  = 1;
+}
+
+/*	ʿ⡢CacheԴӰʿҵøıƥ
+ *	ģʽƬεļҪ飻ʱʱ޸ci_optionԲȽá
+ */
+static void CheckCiLattice()
+{
+	if (ci_lattice_ready &&
+		ci_lattice_version == share_segment->candidate_data_version &&
+		ci_lattice_wildcard == (pim_config->ci_option & CI_WILDCARD) &&
+		ci_lattice_pinyin_mode == pim_config->pinyin_mode)
+		return;
+
+	ClearCiLattice();
+
+	ci_lattice_version	   = share_segment->candidate_data_version;
+	ci_lattice_wildcard	   = pim_config->ci_option & CI_WILDCARD;
+	ci_lattice_pinyin_mode = pim_config->pinyin_mode;
+}
+
+/*	ڴƥвƬ
+ *	أ
+ *		Ƭţ-1Ϊûҵ
+ */
+static int FindCiLatticeSpan(unsigned int hash, SYLLABLE *syllable_array, int syllable_count, int fuzzy_mode)
+{
+	CILATTICESPAN *span;
+	int i, index;
+
+	for (index = ci_lattice_buckets[hash]; index != -1; index = span->next)
 	{
-		if (syllable_array[i].tone != TONE_0)
-			has_tone = 1;
+		span = &ci_lattice_spans[index];
+		if (span->syllable_count != syllable_count || span->fuzzy_mode != fuzzy_mode)
+			continue;
 
-		if (syllable_array[i].con == CON_ANY)
-			has_wild = 1;
+		for (i = 0; i < syllable_count; i++)
+			if (!SameSyllable(span->syllable[i], syllable_array[i]))
+				break;
+
+		if (i == syllable_count)
+			return index;
 	}
 
-	if (!has_tone)		//ûд߰ͨѾųֱӷ
-		return candidate_count;
+	return -1;
+}
+
+/*	Ƭɢбеλ
+ */
+static unsigned int GetCiLatticeHash(SYLLABLE *syllable_array, int syllable_count, int fuzzy_mode)
+{
+	unsigned int hash = 0;
+	int i;
+
+	for (i = 0; i < syllable_count; i++)
+		hash = hash * 31 + *(unsigned short*)&syllable_array[i];
+
+	return (hash ^ (hash >> 10) ^ fuzzy_mode) % CI_LATTICE_HASH_SIZE;
+}
+
+/*	ڴƥΪƬηռ䣨ƬѾʱ滻ԭĴʣɵ߼롣
+ *	ȫ
+ *	
+ *		syllable_array			
+ *		syllable_count			ڳ
+ *		fuzzy_mode				ģѡ
+ *		word_count				ҪĴĿ
+ *	أ
+ *		Ƭָ룬ĿΪ0completeΪ1
+ */
+static CILATTICESPAN *NewCiLatticeSpan(SYLLABLE *syllable_array, int syllable_count, int fuzzy_mode, int word_count)
+{
+	CILATTICESPAN *span;
+	unsigned int hash = GetCiLatticeHash(syllable_array, syllable_count, fuzzy_mode);
+	int index = FindCiLatticeSpan(hash, syllable_array, syllable_count, fuzzy_mode);
 
-	if (has_wild)
+	if ((index == -1 && ci_lattice_span_count == CI_LATTICE_MAX_SPANS) ||
+		ci_lattice_word_count + word_count > CI_LATTICE_MAX_WORDS)
 	{
-		for (i = 0; i < candidate_count; i++)
+		ClearCiLattice();
+		index = -1;
+	}
+
+	if (index == -1)
+	{
+		index = ci_lattice_span_count++;
+		span  = &ci_lattice_spans[index];
+
+		memcpy(span->syllable, syllable_array, sizeof(SYLLABLE) * syllable_count);
+		span->syllable_count = syllable_count;
+		span->fuzzy_mode	 = fuzzy_mode;
+		span->next			 = ci_lattice_buckets[hash];
+
+		ci_lattice_buckets[hash] = index;
+	}
+
+	span = &ci_lattice_spans[index];
+	span->complete	 = 1;
+	span->word_start = ci_lattice_word_count;
+	span->word_count = 0;
+
+	return span;
+}
+
+//һʿвҴʵ
+typedef struct tagCILOOKUPTASK
+{
+	int			*wordlib_ids;					//ʿʶ
+	int			wordlib_count;					//ʿĿ
+	SYLLABLE	*syllable_array;				//
+	int			syllable_count;					//ڳ
+	int			min_count;						//һβҸǰ׺ʱǰ׺0Ϊֻsyllable_countڵĴ
+	int			fuzzy_mode;						//ģѡ
+	CANDIDATE	*candidate_array;				//ѡ
+	int			candidate_length;				//ѡ鳤
+	int			count;							//ѡĿ-1Ϊһβǰ׺
+}CILOOKUPTASK;
+
+/*	һʿβҴʣڹִ߳УֻȡʿԼʿ
+ */
+static void LookupCiInWordLibs(void *param)
+{
+	CILOOKUPTASK *task = (CILOOKUPTASK*)param;
+	int ret, i;
+
+	task->count = 0;
+	for (i = 0; i < task->wordlib_count; i++)
+	{
+		if (task->min_count)
 		{
-			if (!WildCompareSyllablesWithCi(syllable_array, syllable_count, candidate_array[i].word.syllable, candidate_array[i].word.hz, candidate_array[i].word.item->syllable_length, 0))
+			ret = GetCiPrefixCandidates(task->wordlib_ids[i], task->syllable_array, task->syllable_count, task->min_count,
+										task->candidate_array + task->count, task->candidate_length - task->count, task->fuzzy_mode);
+			if (ret < 0)
 			{
-				candidate_array[i] = candidate_array[candidate_count - 1];
-				candidate_count--;
-				i--;
-				continue;
+				task->count = -1;
+				return;
 			}
 		}
+		else
+			ret = GetCiCandidates(task->wordlib_ids[i], task->syllable_array, task->syllable_count,
+								  task->candidate_array + task->count, task->candidate_length - task->count, task->fuzzy_mode);
+
+		task->count += ret;
+	}
+}
+
+#define	CI_PARALLEL_MIN_WORDLIBS		4		//ʿĿﵽֵʱв
+#define	CI_PARALLEL_MIN_SCAN_WORDLIBS	2		//ҪҳĴʿĿﵽֵʱв
+
+/*	жϲҵĹǷֵʹù̡߳ʿûͨĲֻǼζֲң
+ *	ַ񡢺ϲĿȲұֻдʿ϶ࡢжҪҳ
+ *	ʿ⣨ûб룬һβҸǰ׺ʹͨʱŲС
+ *	
+ *		wordlib_ids				ʿʶ
+ *		wordlib_count			ʿĿ
+ *		syllable_array			
+ *		syllable_count			ڳ
+ *		min_count				һβҸǰ׺ʱǰ׺
+ *	أ
+ *		У1
+ *		˳0
+ */
+static int IsCiLookupWorthParallel(const int *wordlib_ids, int wordlib_count, SYLLABLE *syllable_array, int syllable_count, int min_count)
+{
+	WORDLIB *wordlib;
+	int scan_count = 0, i;
+
+	if (wordlib_count < 2)
+		return 0;
+
+	if (wordlib_count >= CI_PARALLEL_MIN_WORDLIBS)
+		return 1;
+
+	for (i = 0; i < syllable_count; i++)
+		if (syllable_array[i].con == CON_ANY)		//ͨ
+			return 1;
+
+	for (i = 0; i < wordlib_count; i++)
+	{
+		wordlib = GetWordLibrary(wordlib_ids[i]);
+		if (wordlib && (min_count || !IsCompiledWordLibrary(wordlib)))
+			scan_count++;
+	}
+
+	return scan_count >= CI_PARALLEL_MIN_SCAN_WORDLIBS;
+}
+
+/*	ڴеȫʿвҴʣմʿĴӣʿҵĽͬ
+ *	ҵĹ㹻IsCiLookupWorthParallelʱʿηΪɹ߳ͬʱ
+ *	ңһ֮ĽʱУҽմϲÿһĺѡ
+ *	ȫǰ沿֣ڱ߳˳ҡ
+ *	
+ *		syllable_array			
+ *		syllable_count			ڳ
+ *		min_count				һβҸǰ׺ʱǰ׺0Ϊֻsyllable_countڵĴ
+ *		candidate_array			ѡ
+ *		candidate_length		ѡ鳤
+ *		fuzzy_mode				ģѡ
+ *	أ
+ *		ѡĿ
+ *		-1һβǰ׺
+ */
+static int GetCiInAllWordLibs(SYLLABLE *syllable_array, int syllable_count, int min_count, CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode)
+{
+	CILOOKUPTASK lookup_tasks[WORKER_MAX_THREADS + 1];
+	WORKERTASK tasks[WORKER_MAX_THREADS + 1];
+	TEMPMEMORYMARK mark = GetTempMemoryMark();
+	int wordlib_ids[MAX_WORDLIBS];
+	int wordlib_count = 0, task_count, count = 0, length, i;
+
+	for (i = GetNextWordLibId(-1); i != -1; i = GetNextWordLibId(i))
+		wordlib_ids[wordlib_count++] = i;
+
+	if (!wordlib_count)
+		return 0;
+
+	//ֻڱ߳з䣬ܷʱֻʹһ
+	task_count = IsCiLookupWorthParallel(wordlib_ids, wordlib_count, syllable_array, syllable_count, min_count)
+				 ? min(wordlib_count, GetWorkerCount() + 1) : 1;
+	for (i = 1; i < task_count; i++)
+	{
+		lookup_tasks[i].candidate_array = AllocateTempMemory(sizeof(CANDIDATE) * candidate_length);
+		if (!lookup_tasks[i].candidate_array)
+		{
+			FreeTempMemory(mark);
+			task_count = 1;
+			break;
+		}
+	}
 
-		return candidate_count;
+	lookup_tasks[0].candidate_array = candidate_array;
+	for (i = 0; i < task_count; i++)
+	{
+		lookup_tasks[i].wordlib_ids		 = wordlib_ids + wordlib_count * i / task_count;
+		lookup_tasks[i].wordlib_count	 = wordlib_count * (i + 1) / task_count - wordlib_count * i / task_count;
+		lookup_tasks[i].syllable_array	 = syllable_array;
+		lookup_tasks[i].syllable_count	 = syllable_count;
+		lookup_tasks[i].min_count		 = min_count;
+		lookup_tasks[i].fuzzy_mode		 = fuzzy_mode;
+		lookup_tasks[i].candidate_length = candidate_length;
+
+		tasks[i].proc  = LookupCiInWordLibs;
+		tasks[i].param = &lookup_tasks[i];
 	}
 
-	for (i = 0; i < candidate_count; i++)
+	//ƥڹֻ߳
+	if (task_count > 1)
+		PrepareSyllableMatchTable(fuzzy_mode);
+
+	RunWorkerTasks(tasks, task_count);
+
+	for (i = 0; i < task_count; i++)
 	{
-		for (j = 0; j < syllable_count; j++)
+		if (lookup_tasks[i].count < 0)
 		{
-			if (syllable_array[j].tone != TONE_0 && !ZiContainTone(candidate_array[i].word.hz[j], candidate_array[i].word.syllable[j], syllable_array[j].tone))
-				break;
+			count = -1;
+			break;
 		}
 
-		if (j != syllable_count)			//Ҫ
+		length = min(lookup_tasks[i].count, candidate_length - count);
+		if (i && length > 0)
+			memcpy(candidate_array + count, lookup_tasks[i].candidate_array, sizeof(CANDIDATE) * length);
+
+		count += length;
+	}
+
+	FreeTempMemory(mark);
+
+	return count;
+}
+
+/*	ƬȫʿƥĴʵľƬѾڴƥʱֱʹã
+ *	ȫʿⲢ뵽ƥС
+ *	
+ *		syllable_array			
+ *		syllable_count			ڳ
+ *		handles					ʺѡ
+ *		candidate_array			Ҵʿʱʹõĺѡ飨ȳ
+ *		candidate_length		鳤
+ *		fuzzy_mode				ģѡ
+ *	أ
+ *		Ŀ
+ */
+static int GetCiLatticeHandles(SYLLABLE *syllable_array, int syllable_count, CIHANDLE *handles, CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode)
+{
+	CILATTICESPAN *span;
+	CILATTICEWORD *word;
+	int index, count;
+	int i;
+
+	//ڹٻ߹ڴʿвҵ
+	if (syllable_count < 2 || syllable_count > MAX_WORD_LENGTH || candidate_length <= 0)
+		return 0;
+
+	CheckCiLattice();
+
+	index = FindCiLatticeSpan(GetCiLatticeHash(syllable_array, syllable_count, fuzzy_mode), syllable_array, syllable_count, fuzzy_mode);
+	if (index != -1 && (ci_lattice_spans[index].complete || ci_lattice_spans[index].word_count >= candidate_length))
+	{
+		span = &ci_lattice_spans[index];
+		for (i = 0; i < span->word_count && i < candidate_length; i++)
 		{
-			candidate_array[i] = candidate_array[candidate_count - 1];
-			candidate_count--;
-			i--;
+			word = &ci_lattice_words[span->word_start + i];
 
-			continue;
+			handles[i].item	  = word->item;
+			handles[i].source = (short)word->source;
+			handles[i].type	  = CI_TYPE_NORMAL;
 		}
+
+		return i;
+	}
+
+	//ڴеȫʿвҺѡ
+	count = GetCiInAllWordLibs(syllable_array, syllable_count, 0, candidate_array, candidate_length, fuzzy_mode);
+
+	for (i = 0; i < count; i++)
+		MakeCiHandle(&handles[i], &candidate_array[i], i);
+
+	if (count > CI_LATTICE_MAX_WORDS)
+		return count;
+
+	//ѡʱõֻǰһִʣҪ²
+	span = NewCiLatticeSpan(syllable_array, syllable_count, fuzzy_mode, count);
+	span->complete	 = count < candidate_length;
+	span->word_count = count;
+
+	for (i = 0; i < count; i++)
+	{
+		ci_lattice_words[ci_lattice_word_count + i].item   = handles[i].item;
+		ci_lattice_words[ci_lattice_word_count + i].source = handles[i].source;
 	}
 
-	return candidate_count;
+	ci_lattice_word_count += count;
+
+	return count;
 }
 
-/*	ڴʵĺѡ
- *		1. úѡںѡԼĸѡ
- *		2. 
- *		3. 
+/*	ôʲҵģʽ
  *	
  *		syllable_array			
  *		syllable_count			ڳ
- *		letters					û봮Ϊ0ʱΪ
- *		candidate_array			ѡ
- *		candidate_length		ѡ鳤
  *		same_ci_syllable_length	ǷҪڵĳͬ
  *	أ
- *		ѡĿ
+ *		ģʽ
  */
-int ProcessCiCandidate(SYLLABLE *syllable_array, int syllable_count, const TCHAR *letters, CANDIDATE *candidate_array, int candidate_length, int same_ci_syllable_length)
+static int GetCiFuzzyMode(SYLLABLE *syllable_array, int syllable_count, int same_ci_syllable_length)
 {
-	int count = 0;					//ѡĿ
-	int fuzzy_mode = pim_config->use_fuzzy ? pim_config->fuzzy_mode : 0;			//ģʽ
-	int wordlib_id;					//ʿʶ
+	int fuzzy_mode = pim_config->use_fuzzy ? pim_config->fuzzy_mode : 0;
 	int i;
 
-	assert(syllable_array && candidate_array && syllable_count >= 1);
-
 	//аԶģ
 	if (pim_config->ci_option & CI_AUTO_FUZZY)
 		fuzzy_mode |= FUZZY_ZCS_IN_CI;
@@ -1013,31 +2063,146 @@ int ProcessCiCandidate(SYLLABLE *syllable_array, int syllable_count, const TCHAR
 	if (!same_ci_syllable_length)
 		fuzzy_mode |= FUZZY_CI_SYLLABLE_LENGTH;
 
-	//ڴеȫʿвҺѡ
-	wordlib_id = GetNextWordLibId(-1);
-	while (wordlib_id != -1)
+	//ڣڴʿʱĴʳȥռúѡ
+	for (i = 0; i < syllable_count; i++)
+		if (syllable_array[i].tone != TONE_0)
+		{
+			fuzzy_mode |= FUZZY_CI_TONE;
+			break;
+		}
+
+	return fuzzy_mode;
+}
+
+/*	һβҵõиǰ׺min_countsyllable_countڣȫʿƥĴʣ
+ *	ճȷ뵽ƥУ֮ȵProcessCiCandidateֱʹôƥ
+ *	ٷֱҴʿ⡣ͨʿⲻһβԼѡʱ
+ *	
+ *		syllable_array			
+ *		syllable_count			ǰ׺
+ *		min_count				ǰ׺
+ *		same_ci_syllable_length	ǷҪڵĳͬ
+ *	أ
+ */
+void PrepareCiPrefixCandidates(SYLLABLE *syllable_array, int syllable_count, int min_count, int same_ci_syllable_length)
+{
+	TEMPMEMORYMARK mark;
+	CILATTICESPAN *span;
+	CANDIDATE *candidates;
+	int group_counts[MAX_WORD_LENGTH + 1];
+	int fuzzy_mode, count, length, index, i;
+
+	if (syllable_count > MAX_WORD_LENGTH)
+		syllable_count = MAX_WORD_LENGTH;
+
+	if (min_count < 2)
+		min_count = 2;
+
+	//ֻһʱҪ
+	if (syllable_count <= min_count)
+		return;
+
+	for (i = 0; i < syllable_count; i++)
+		if (syllable_array[i].tone != TONE_0 || syllable_array[i].con == CON_ANY)
+			return;
+
+	fuzzy_mode = GetCiFuzzyMode(syllable_array, syllable_count, same_ci_syllable_length);
+
+	CheckCiLattice();
+
+	//ȫȶѾڴƥ
+	for (length = min_count; length <= syllable_count; length++)
 	{
-		count += GetCiCandidates(wordlib_id, syllable_array, syllable_count, candidate_array + count, candidate_length - count, fuzzy_mode);
-		wordlib_id = GetNextWordLibId(wordlib_id);
-	};
+		index = FindCiLatticeSpan(GetCiLatticeHash(syllable_array, length, fuzzy_mode), syllable_array, length, fuzzy_mode);
+		if (index == -1 || !ci_lattice_spans[index].complete)
+			break;
+	}
+
+	if (length > syllable_count)
+		return;
+
+	mark	   = GetTempMemoryMark();
+	candidates = AllocateTempMemory(sizeof(CANDIDATE) * MAX_CANDIDATES);
+	if (!candidates)
+		return;
+
+	count = GetCiInAllWordLibs(syllable_array, syllable_count, min_count, candidates, MAX_CANDIDATES, fuzzy_mode);
 
-	//ĻҪĴʳȥ
-	count = DeleteCiCandidateByTone(syllable_array, syllable_count, candidate_array, count);
+	//ѡʱȷȵĴǷɸȷֱ
+	if (count < 0 || count >= MAX_CANDIDATES)
+	{
+		FreeTempMemory(mark);
+		return;
+	}
+
+	memset(group_counts, 0, sizeof(group_counts));
+	for (i = 0; i < count; i++)
+		group_counts[candidates[i].word.item->syllable_length]++;
+
+	//ճȷƥڱִʿԼʿеĴ
+	for (length = min_count; length <= syllable_count; length++)
+	{
+		index = FindCiLatticeSpan(GetCiLatticeHash(syllable_array, length, fuzzy_mode), syllable_array, length, fuzzy_mode);
+		if (index != -1 && ci_lattice_spans[index].complete)
+			continue;
+
+		span = NewCiLatticeSpan(syllable_array, length, fuzzy_mode, group_counts[length]);
+		for (i = 0; i < count; i++)
+		{
+			if (candidates[i].word.item->syllable_length != length)
+				continue;
+
+			ci_lattice_words[ci_lattice_word_count].item   = candidates[i].word.item;
+			ci_lattice_words[ci_lattice_word_count].source = candidates[i].word.source;
+			ci_lattice_word_count++;
+			span->word_count++;
+		}
+	}
+
+	FreeTempMemory(mark);
+}
+
+/*	ڴеȫʿвĸʺѡ
+ *	
+ *		letters					û봮Ϊ0ʱΪ
+ *		candidate_array			ѡ
+ *		candidate_length		ѡ鳤
+ *	أ
+ *		ѡĿ
+ */
+static int GetLetterCiCandidates(const TCHAR *letters, CANDIDATE *candidate_array, int candidate_length)
+{
+	int count = 0;					//ѡĿ
+	int wordlib_id;					//ʿʶ
 
 	//ĸ룬ҪжǷΪ1ڣΪһڣ
 	//ܽеĸ루"лŮ"⣩
 	//Ժ󣬲ñڵѡ֮ķС
-	if (letters && (pim_config->ci_option & CI_USE_FIRST_LETTER) &&
-		(int)_tcslen(letters) >= pim_config->first_letter_input_min_hz)
+	if (!letters || !(pim_config->ci_option & CI_USE_FIRST_LETTER) ||
+		(int)_tcslen(letters) < pim_config->first_letter_input_min_hz)
+		return 0;
+
+	wordlib_id = GetNextWordLibId(-1);
+	while (wordlib_id != -1)
 	{
-		//ڴеȫʿвҺѡ
-		wordlib_id = GetNextWordLibId(-1);
-		while (wordlib_id != -1)
-		{
-			count += GetCiCandidatesByLetter(wordlib_id, letters, candidate_array + count, candidate_length - count);
-			wordlib_id = GetNextWordLibId(wordlib_id);
-		};
-	}
+		count += GetCiCandidatesByLetter(wordlib_id, letters, candidate_array + count, candidate_length - count);
+		wordlib_id = GetNextWordLibId(wordlib_id);
+	};
+
+	return count;
+}
+
+/*	ʱڴ治ʱֱںѡϻôʺѡԼ򣨲ʹôƥ
+ */
+static int ProcessCiCandidateInPlace(SYLLABLE *syllable_array, int syllable_count, const TCHAR *letters, CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode)
+{
+	int count = 0;					//ѡĿ
+	int i;
+
+	if (syllable_count >= 2 && syllable_count <= MAX_WORD_LENGTH)
+		count = GetCiInAllWordLibs(syllable_array, syllable_count, 0, candidate_array, candidate_length, fuzzy_mode);
+
+	count += GetLetterCiCandidates(letters, candidate_array + count, candidate_length - count);
 
 	//
 	count = UnifyCiCandidates(candidate_array, count);
@@ -1051,6 +2216,70 @@ int ProcessCiCandidate(SYLLABLE *syllable_array, int syllable_count, const TCHAR
 	return count;
 }
 
+/*	ڴʵĺѡ
+ *		1. úѡںѡԼĸѡ
+ *		2. 
+ *		3. 
+ *	áԼڴʺѡϽУźôÿֻһκѡ
+ *	
+ *		syllable_array			
+ *		syllable_count			ڳ
+ *		letters					û봮Ϊ0ʱΪ
+ *		candidate_array			ѡ
+ *		candidate_length		ѡ鳤
+ *		same_ci_syllable_length	ǷҪڵĳͬ
+ *	أ
+ *		ѡĿ
+ */
+int ProcessCiCandidate(SYLLABLE *syllable_array, int syllable_count, const TCHAR *letters, CANDIDATE *candidate_array, int candidate_length, int same_ci_syllable_length)
+{
+	TEMPMEMORYMARK mark = GetTempMemoryMark();
+	CIHANDLE *handles;				//ʺѡ
+	int count = 0;					//ѡĿ
+	int letter_count;				//ĸѡĿ
+	int fuzzy_mode;					//ģʽ
+	int i;
+
+	assert(syllable_array && candidate_array && syllable_count >= 1);
+
+	fuzzy_mode = GetCiFuzzyMode(syllable_array, syllable_count, same_ci_syllable_length);
+
+	handles = AllocateTempMemory(sizeof(CIHANDLE) * candidate_length);
+	if (!handles)
+		return ProcessCiCandidateInPlace(syllable_array, syllable_count, letters, candidate_array, candidate_length, fuzzy_mode);
+
+	//ڴеȫʿвҺѡͨƥ񣬸׶βͬƬʱظҴʿ⣩
+	count = GetCiLatticeHandles(syllable_array, syllable_count, handles, candidate_array, candidate_length, fuzzy_mode);
+
+	//ĸʺѡѡֻڲңõĴټ
+	letter_count = GetLetterCiCandidates(letters, candidate_array, candidate_length - count);
+	for (i = 0; i < letter_count; i++)
+		MakeCiHandle(&handles[count + i], &candidate_array[i], 0);
+
+	count += letter_count;
+
+	//
+	count = UnifyCiHandles(handles, count);
+
+	for (i = 0; i < count; i++)
+	{
+		handles[i].cache_pos = GetCiCacheInfo(GetItemHZPtr(handles[i].item), handles[i].item->ci_length);
+		handles[i].order	 = i;
+		handles[i].sort_key	 = GetCiSortKey(handles[i].item, handles[i].cache_pos);
+	}
+
+	//
+	SortCiHandles(handles, count);
+
+	//ֻɴʺѡ
+	for (i = 0; i < count; i++)
+		MakeCiCandidate(&candidate_array[i], &handles[i]);
+
+	FreeTempMemory(mark);
+
+	return count;
+}
+
 /*	ȡܴڻϽĺѡ
  *	
  *		syllable_array			
@@ -1064,6 +2293,7 @@ int GetMixedParseCiCandidate(SYLLABLE *syllable_array, int syllable_count, CANDI
 {
 	SYLLABLE  base_syllables[3];    //
 	int count = 0;					//ѡĿ
+	int fuzzy_mode = 0;				//ģʽ
 	int wordlib_id;					//ʿʶ
 	int i;
 
@@ -1083,13 +2313,14 @@ int GetMixedParseCiCandidate(SYLLABLE *syllable_array, int syllable_count, CANDI
 	//QΪβʹκģ
 	//Akernel.côע
 
+	//base_syllablesʱڴʿʱƥĴʳȥ
+	if (base_syllables[0].tone != TONE_0 || base_syllables[1].tone != TONE_0)
+		fuzzy_mode |= FUZZY_CI_TONE;
+
 	//ڴеȫʿвҺѡ
 	wordlib_id = GetUserWordLibId();
 	if (wordlib_id != -1)
-		count += GetCiCandidates(wordlib_id, base_syllables, 3, candidate_array + count, candidate_length - count, 0);
-
-	//base_syllablesĻҪcandidate_arrayƥĴʳȥ
-	count = DeleteCiCandidateByTone(base_syllables, 3, candidate_array, count);
+		count += GetCiCandidates(wordlib_id, base_syllables, 3, candidate_array + count, candidate_length - count, fuzzy_mode);
 
 	//ϽҪ4
 	for (i = 0; i < count; i++)
@@ -2,6 +2,7 @@
  *	óעװϢעвϢʱ
  *	Ĭϵõע
  */
+#include <stddef.h>
 #include <kernel.h>
 #include <config.h>
 #include <context.h>
@@ -517,6 +518,18 @@ PIMCONFIG default_config =				//Ĭ
 
 	//λãĬ500, 500
 	500, 1800,
+
+	//ÿһ·Ŀȣʺѡһʱʹã
+	4,
+
+	//ʺѡĿΪ1ʱǰֻͬںѡзһʽʱ·
+	1,
+
+	//ÿΰúѡʱƣ룬0Ϊƣ
+	100,
+
+	//úѡʹõ߳Ŀ0ΪմĿ1Ϊֻʹ뷨̣߳
+	0,
 };
 
 #pragma data_seg()
@@ -943,8 +956,33 @@ int ExistThemeFile(const TCHAR *file_name)
 	return 0;
 }
 
+//汾óȡµPIMCONFIGĩβǵǰõǰһ
+static const int old_config_lengths[] =
+{
+	offsetof(PIMCONFIG, icw_beam_width),			//ʼ֮ǰ
+	offsetof(PIMCONFIG, candidate_time_limit),		//Ӻѡʱ֮ǰ
+	offsetof(PIMCONFIG, candidate_thread_count),	//Ӻѡ߳Ŀ֮ǰ
+};
+
+/**	жעõĳǷΪǰ汾ó
+ */
+static int IsKnownConfigLength(DWORD data_length)
+{
+	int i;
+
+	if (data_length == sizeof(PIMCONFIG))
+		return 1;
+
+	for (i = 0; i < sizeof(old_config_lengths) / sizeof(old_config_lengths[0]); i++)
+		if (data_length == (DWORD)old_config_lengths[i])
+			return 1;
+
+	return 0;
+}
+
 /*	עж뷨Ϣ
- *	עΪһڴݣСΪPIMCONFIGSIZE
+ *	עΪһڴݣСΪPIMCONFIGSIZE汾ý϶̣
+ *	ȱٵʹĬֵ
  */
 void WINAPI LoadConfig(PIMCONFIG *config)
 {
@@ -981,7 +1019,8 @@ void WINAPI LoadConfig(PIMCONFIG *config)
 		return;
 	}
 
-	//ȡϢ
+	//ȡϢ汾ý϶ʱӵĬֵ
+	memcpy(config, &default_config, sizeof(PIMCONFIG));
 	ret = RegQueryValueEx(reg_key, REG_CONFIG_ITEM_NAME, 0, &data_type, (LPBYTE)config, &data_length);
 
 	//
@@ -996,8 +1035,8 @@ void WINAPI LoadConfig(PIMCONFIG *config)
 	//if(config->key_pair_zi_from_word < 4)
 	//	config->key_pair_zi_from_word = KEY_PAIR_2;
 
-	if (ret == ERROR_SUCCESS && data_length == sizeof(PIMCONFIG) && data_type == REG_BINARY)	//ɹȡ
-		Log(LOG_ID, L"ļɹװ");
+	if (ret == ERROR_SUCCESS && IsKnownConfigLength(data_length) && data_type == REG_BINARY)	//ɹȡ
+		Log(LOG_ID, L"ļɹװأ:%d", data_length);
 	else
 	{
 		Log(LOG_ID, L"עȡʧܣerrcode = %d", ret);		//ʧ
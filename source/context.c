@@ -125,6 +125,7 @@ void ResetContext(PIMCONTEXT *context)
 	context->candidate_count		= 0;
 	context->candidate_index		= 0;
 	context->candidate_page_count	= 0;
+	context->candidate_incomplete	= 0;
 	context->compose_cursor_index	= 0;
 	context->compose_length			= 0;
 	context->compose_string[0]		= 0;
@@ -6,6 +6,8 @@
  *	3. ʽ޸Ϊķʽ
  *	4. ö̬滮бд㷨
  *	5. ICWĴԽԽãóв
+ *	6. Ϊǰ̬滮·һΰڱ仯ʱֻ¼Ӱ
+ *	7. Ϊȫ֣ٲʣʱʹѾõĴʣһμ
  *
  *
  *	TCOC: СƵ4096Ŵ32
@@ -17,20 +19,30 @@
 #include <config.h>
 #include <utility.h>
 #include <map_file.h>
+#include <share_segment.h>
 
 int	show_icw_info = 0;
 FILEMAPHANDLE	bigram_handle;
 GRAM_DATA		*bigram_data;
 int				bigram_data_length = 0;
 
+//俪ʼĳһһ·
+typedef struct tagICWPATH
+{
+	double					value;			//ֵ
+	struct tagNEWICWITEM	*prev;			//ǰһ0Ϊ俪ʼ
+	int						prev_path;		//ǰһе·
+}ICWPATH;
+
 typedef struct tagNEWICWITEM
 {
 	int			length;						//ѡĳ
 	HZ			*hz;						//
 	SYLLABLE	*syllable;					//
 	int			freq;						//ƵߴƵ
-	double		value;						//ֵ
-	struct tagNEWICWITEM	*next;			//һ
+	BIGRAM_WORD	word;						//bigramеıʶ
+	int			path_count;					//·Ŀ
+	ICWPATH		path[ICW_MAX_BEAM_WIDTH];	//ֵ·ɴС
 }NEWICWITEM;
 
 typedef struct tagICWLIFE
@@ -42,15 +54,36 @@ typedef struct tagICWLIFE
 typedef struct tagICWGROUPITEM
 {
 	int			count;
+	int			evaluated_count;					//Ѿ·Ŀ
+	int			span;								//дʵ0Ϊûв
+	int			span_end[ICW_MAX_WORD_LENGTH + 1];	//±ĿǰʰСУ
+	int			zi_fallback;						//ʹ˸󼯺ϵĺ
 	NEWICWITEM	item[ICW_MAX_CI_ITEMS];
 }ICWGROUPITEM;
 
 typedef struct tagICWITEMSET
 {
 	int				group_count;
+	BIGRAM_WORD		sentence_word;			//俪ʼbigramеıʶ
 	ICWGROUPITEM	group_item[MAX_ICW_LENGTH];
 }ICWITEMSET;
 
+//״̬һΰĸѡԼǰ·ڴ仯ʱֻ¼仯
+typedef struct tagICWSTATE
+{
+	ICWITEMSET		*icw_items;				//ĺѡ
+	SYLLABLE		syllable[MAX_ICW_LENGTH];	//ѡ
+	int				syllable_count;			//Ŀ
+	int				valid_count;			//ѡԼ·ЧĿ0鿪ʼ
+	unsigned int	last_used;				//ʹõ
+}ICWSTATE;
+
+static ICWSTATE		icw_states[ICW_MAX_STATES];
+static unsigned int	icw_state_clock		 = 0;
+static int			icw_state_version	 = 0;		//״̬ʱĺѡ޸ļ
+static int			icw_state_beam_width = 0;		//״̬ʱļ
+static GRAM_DATA	*icw_state_bigram	 = 0;		//״̬ʱbigram
+static PIMCONFIG	icw_state_config;				//״̬ʱ
 
 static int show_detail_bigram = 0;
 
@@ -131,81 +164,268 @@ int MakeBigramFaster()
  */
 int FreeBigramData()
 {
+	int i;
+
+	//״̬бbigramеıʶһͷ
+	for (i = 0; i < ICW_MAX_STATES; i++)
+	{
+		if (icw_states[i].icw_items)
+			free(icw_states[i].icw_items);
+
+		icw_states[i].icw_items	  = 0;
+		icw_states[i].valid_count = 0;
+	}
+
 	FileMapClose(bigram_handle);
 	bigram_data = 0;
 	bigram_handle = 0;
 	return 1;
 }
 
-/**	ICW
+/**	ѡ뵽УֻԼʳȵڳȵĴʣеmax_count
  */
-int GenerateICWItems(ICWITEMSET *icw_items, SYLLABLE *syllable, int syllable_count)
+static void AddIcwGroupItems(ICWGROUPITEM *group, CANDIDATE *candidates, int count, int max_count)
 {
-	//CANDIDATE	candidates[ICW_MAX_ITEMS];
-	CANDIDATE	*candidates;	//ΪڶϷռ䣬ջ
-	int			count;
-	int			i, j;
+	NEWICWITEM *item;
+	char c0[0x20];
+	char ci0[0x20];
+	int i;
+
+	for (i = 0; i < count && group->count < max_count; i++)
+	{
+		item = &group->item[group->count];
+		if (candidates[i].type == CAND_TYPE_ZI)
+		{
+			item->length	= 1;
+			item->hz		= (HZ*)&candidates[i].hz.item->hz;
+			item->syllable	= &candidates[i].hz.item->syllable;
+			item->freq		= ConvertToRealHZFreq((int)(candidates[i].hz.item->freq));
+		}
+		else if (candidates[i].type == CAND_TYPE_CI &&
+			candidates[i].word.item->ci_length == candidates[i].word.item->syllable_length)
+		{
+			item->length	= candidates[i].word.item->ci_length;
+			item->hz		= candidates[i].word.hz;
+			item->syllable	= candidates[i].word.syllable;
+			item->freq		= ConvertToRealCIFreq((int)candidates[i].word.item->freq);
+		}
+		else
+			continue;
+
+		//Һѡbigramеıʶֵʱٽת
+		memset(c0, 0, sizeof(c0));
+		memcpy(c0, (char*)item->hz, item->length * 2);
+		Utf16ToAnsi((TCHAR*)c0, ci0, sizeof(ci0));
+		GetBigramWord(bigram_data, ci0, &item->word);
+
+		item->path_count = 0;
+		group->count++;
+	}
+}
+
+/**	ƵɴСıȽ
+ */
+static int CompareIcwZiFreq(const void *p1, const void *p2)
+{
+	int freq1 = *(const int*)p1, freq2 = *(const int*)p2;
+
+	return freq1 < freq2 ? 1 : freq1 > freq2 ? -1 : 0;
+}
+
+/**	ֹࣨƴģʱֻƵߵICW_MAX_ZI_ITEMS֣
+ *	λʡĺֱԭĴ
+ *	
+ *		candidates			ֺѡ
+ *		count				Ŀ
+ *	أ
+ *		ĺĿ
+ */
+static int SelectIcwZiItems(CANDIDATE *candidates, int count)
+{
+	TEMPMEMORYMARK mark;
+	int *freqs;
+	int threshold, above_count, i, j;
+
+	if (count <= ICW_MAX_ZI_ITEMS)
+		return count;
+
+	mark  = GetTempMemoryMark();
+	freqs = AllocateTempMemory(sizeof(int) * count);
+	if (!freqs)
+		return ICW_MAX_ZI_ITEMS;
+
+	for (i = 0; i < count; i++)
+		freqs[i] = candidates[i].hz.item->freq;
+
+	qsort(freqs, count, sizeof(int), CompareIcwZiFreq);
+	threshold = freqs[ICW_MAX_ZI_ITEMS - 1];
+
+	FreeTempMemory(mark);
+
+	//Ƶ޵ȫ޵İմ
+	for (i = above_count = 0; i < count; i++)
+		if (candidates[i].hz.item->freq > threshold)
+			above_count++;
+
+	for (i = j = 0; i < count && j < ICW_MAX_ZI_ITEMS; i++)
+	{
+		if (candidates[i].hz.item->freq < threshold)
+			continue;
+
+		if (candidates[i].hz.item->freq == threshold)
+		{
+			if (above_count >= ICW_MAX_ZI_ITEMS)
+				continue;
+
+			above_count++;
+		}
+
+		candidates[j++] = candidates[i];
+	}
+
+	return j;
+}
+
+/**	һICWȷźٰ֣СŴʣеֲ䣬
+ *	ֻgroup->spanĴʡICW_MAX_ZI_ITEMS֤㹻λá
+ *	
+ *		group				
+ *		syllable			ӱ鿪ʼ
+ *		span				β䵽Ĵʵ
+ *		full_span			дʵ
+ *		candidates			ѡ
+ *	أ
+ *		е0Ϊûҵѡ(ƴ:chua)
+ */
+static int GenerateIcwGroup(ICWGROUPITEM *group, SYLLABLE *syllable, int span, int full_span, CANDIDATE *candidates)
+{
+	int count, j;
+
+	if (!group->span)
+	{
+		//ú
+		count = GetZiCandidates(syllable[0], candidates, ICW_MAX_ITEMS, pim_config->use_fuzzy ? pim_config->fuzzy_mode : 0, HZ_MORE_USED, HZ_OUTPUT_ICW_ZI);
+		count = SelectIcwZiItems(candidates, count);
+		AddIcwGroupItems(group, candidates, count, ICW_MAX_ZI_ITEMS);
+
+		group->span		   = 1;
+		group->span_end[1] = group->count;
+		group->zi_fallback = 0;
+	}
 
-	candidates = malloc(sizeof(CANDIDATE) * ICW_MAX_ITEMS);
+	for (j = group->span + 1; j <= span; j++)
+	{
+		count = ProcessCiCandidate(syllable, j, 0, candidates, ICW_MAX_ITEMS, 1);
+		AddIcwGroupItems(group, candidates, count, ICW_MAX_CI_ITEMS);
+
+		group->span		   = j;
+		group->span_end[j] = group->count;
+	}
+
+	if (!group->count && span == full_span)		//ȫĴʶҹȻûκ£Ҹ󼯺ϵĺ
+	{
+		count = GetZiCandidates(syllable[0], candidates, ICW_MAX_ITEMS, pim_config->use_fuzzy ? pim_config->fuzzy_mode : 0, HZ_MORE_USED, HZ_OUTPUT_SIMPLIFIED);
+		AddIcwGroupItems(group, candidates, count, ICW_MAX_CI_ITEMS);		//ûдʣֿʹȫλ
+
+		group->zi_fallback = 1;
+	}
+
+	return group->count;
+}
+
+/**	ICWûб仯鱣еʱĴʣʱȥĴʣ
+ *	ȫ²
+ *	Ϊȫ֣鲹ʡúѡʱƺٲһ飩ٲ䣬
+ *	ʱֻʹѾõĴʣcandidate_incompleteһεʱ䡣
+ *	
+ *		icw_items			ICW
+ *		syllable			
+ *		syllable_count		Ŀ
+ *		valid_count			ѾĿ
+ *		same_count			ʱͬĿ
+ *	أ
+ *		ɹĿsyllable_countʱɹ
+ */
+int GenerateICWItems(ICWITEMSET *icw_items, SYLLABLE *syllable, int syllable_count, int valid_count, int same_count)
+{
+	//CANDIDATE	candidates[ICW_MAX_ITEMS];
+	CANDIDATE		*candidates;	//Ϊʱڴзռ䣬ջ
+	ICWGROUPITEM	*group;
+	TEMPMEMORYMARK	mark = GetTempMemoryMark();
+	int				i, span, keep = 1;
+	int				reset_group, extended = 0;
+
+	candidates = AllocateTempMemory(sizeof(CANDIDATE) * ICW_MAX_ITEMS);
+	if (!candidates)
+		return 0;
 
 	//Ŀ
 	icw_items->group_count = syllable_count;
 
-	//ȡÿһڵĺѡ
+	//ȡÿһڵĺ
 	for (i = 0; i < syllable_count; i++)
 	{
-		count = 0;
-		for (j = 2; j <= min(8, syllable_count - i); j++)
-			count += ProcessCiCandidate(syllable + i, j, 0, candidates + count, ICW_MAX_ITEMS - count, 1);
-
-		count = min(ICW_MAX_CI_ITEMS, count);			//ڴʵĳ
+		group = &icw_items->group_item[i];
+		span  = min(ICW_MAX_WORD_LENGTH, syllable_count - i);
 
-		//ú
-		count += GetZiCandidates(syllable[i], candidates + count, ICW_MAX_ITEMS - count, pim_config->use_fuzzy ? pim_config->fuzzy_mode : 0, HZ_MORE_USED, HZ_OUTPUT_ICW_ZI);
-		if (!count)		//ûκ£Ҹ󼯺ϵĺ
-			count += GetZiCandidates(syllable[i], candidates + count, ICW_MAX_ITEMS - count, pim_config->use_fuzzy ? pim_config->fuzzy_mode : 0, HZ_MORE_USED, HZ_OUTPUT_SIMPLIFIED);
+		//еĴʹõûб仯ȥĴʺȻʱԱʹ˸󼯺ϵĺʱܲʣ
+		keep = keep && i < valid_count && i + min(span, group->span) <= same_count &&
+			   !(group->zi_fallback && span > group->span) &&
+			   (group->zi_fallback || span >= group->span || group->span_end[span]);
 
-		count = min(count, ICW_MAX_CI_ITEMS);		//
+		if (!keep)
+		{
+			group->count		   = 0;
+			group->span			   = 0;
+			group->evaluated_count = 0;
+		}
+		else if (span < group->span && !group->zi_fallback)
+		{
+			group->count		   = group->span_end[span];
+			group->evaluated_count = min(group->evaluated_count, group->count);
+			group->span			   = span;
+		}
 
-		if (!count)		//ûҵѡ(ƴ:chua)޷ڴ
+		//ûкʱҴʣԼ󼯺ϵĺ֣
+		if (!GenerateIcwGroup(group, syllable + i, 1, span, candidates) &&
+			!GenerateIcwGroup(group, syllable + i, span, span, candidates))
 		{
-			free(candidates);
-			return 0;
+			FreeTempMemory(mark);
+			return i;
 		}
+	}
 
-		//úԼ
-		for (j = 0; j < count; j++)
+	//ÿһĴ
+	reset_group = syllable_count;
+	for (i = 0; i < syllable_count; i++)
+	{
+		group = &icw_items->group_item[i];
+		span  = min(ICW_MAX_WORD_LENGTH, syllable_count - i);
+
+		if (group->span >= span || group->zi_fallback)
+			continue;
+
+		if (extended && IsCandidateDeadlinePassed())
 		{
-			if (candidates[j].type == CAND_TYPE_ZI)
-			{
-				icw_items->group_item[i].item[j].length		= 1;
-				icw_items->group_item[i].item[j].hz			= (HZ*)&candidates[j].hz.item->hz;
-				icw_items->group_item[i].item[j].syllable	= &candidates[j].hz.item->syllable;
-				icw_items->group_item[i].item[j].freq		= ConvertToRealHZFreq((int)(candidates[j].hz.item->freq));
-			}
-			else if (candidates[j].type == CAND_TYPE_CI &&
-				candidates[j].word.item->ci_length == candidates[j].word.item->syllable_length)
-			{
-				icw_items->group_item[i].item[j].length		= candidates[j].word.item->ci_length;
-				icw_items->group_item[i].item[j].hz			= candidates[j].word.hz;
-				icw_items->group_item[i].item[j].syllable	= candidates[j].word.syllable;
-				icw_items->group_item[i].item[j].freq		= ConvertToRealCIFreq((int)candidates[j].word.item->freq);
-			}
-			else
-			{
-				count--; //countҪȼ1candidates[count]ʵԽ
-				candidates[j] = candidates[count];
-				j--;
-			}
+			candidate_incomplete = 1;
+			break;
 		}
 
-		//ڵĺѡĿ
-		icw_items->group_item[i].count = count;
+		//µĴںЩѾ·Ҫ¼
+		reset_group = min(reset_group, i + group->span + 1);
+
+		GenerateIcwGroup(group, syllable + i, span, span, candidates);
+		extended = 1;
 	}
 
-	free(candidates);
+	for (i = reset_group; i < syllable_count; i++)
+		icw_items->group_item[i].evaluated_count = 0;
 
-	return 1;
+	GetBigramWord(bigram_data, "", &icw_items->sentence_word);
+
+	FreeTempMemory(mark);
+
+	return syllable_count;
 }
 
 /**	ʹBigramйֵ
@@ -261,84 +481,161 @@ void EvaluateLifeByBigram(const ICWITEMSET *icw_items, ICWLIFE *life)
 //	OutputLife((ICWITEMSET*)icw_items, life);
 }
 
-/**	ֵ
+/**	üĿȣÿһ·Ŀ
  */
-void NewEvaluateGroup(ICWITEMSET *icw_items, int group_no)
+static int GetIcwBeamWidth()
 {
-	NEWICWITEM *items, *next_items;
-	int i, j, index, next_group_no;
-	int start, end;
-	int count, next_count;
-	char ci0[0x20], ci1[0x20];
-	double value, max_value;
+	if (pim_config->icw_beam_width < 1)
+		return 1;
 
-	items = icw_items->group_item[group_no].item;
-	count = icw_items->group_item[group_no].count;
-	if (group_no == icw_items->group_count - 1)			//һ
-		end = 1;
+	if (pim_config->icw_beam_width > ICW_MAX_BEAM_WIDTH)
+		return ICW_MAX_BEAM_WIDTH;
 
-	if (!group_no)										//һ
-		start = 1;
+	return pim_config->icw_beam_width;
+}
 
-	for (i = 0; i < count; i++)
-	{
-		char c0[0x20] = {0};
+/**	·뵽·Уֵͬʱȼ·ǰ
+ *	أ
+ *		1ɹ
+ *		0ֵ̫Сûм
+ */
+static int InsertIcwPath(NEWICWITEM *item, int beam_width, double value, NEWICWITEM *prev, int prev_path)
+{
+	int pos;
 
-		memcpy(c0, (char*)items[i].hz, items[i].length * 2);
-		//strncpy_s(ci0, sizeof(ci0), (char*)items[i].hz, items[i].length * 2);
-		Utf16ToAnsi((TCHAR*)c0, ci0, sizeof(ci0));
+	if (item->path_count == beam_width && value <= item->path[beam_width - 1].value)
+		return 0;
 
-		next_group_no = group_no + items[i].length;
-		if (next_group_no == icw_items->group_count)
-		{
-			items[i].value = GetBigramValue(bigram_data, ci0, "");
-			items[i].next = 0;
+	for (pos = item->path_count; pos > 0 && item->path[pos - 1].value < value; pos--)
+		;
+
+	if (item->path_count < beam_width)
+		item->path_count++;
+
+	memmove(item->path + pos + 1, item->path + pos, sizeof(ICWPATH) * (item->path_count - 1 - pos));
+
+	item->path[pos].value	  = value;
+	item->path[pos].prev	  = prev;
+	item->path[pos].prev_path = prev_path;
+
+	return 1;
+}
+
+/**	˳²ǰ·ÿһbeam_width俪ʼ·
+ *	·ֻ֮ǰйأѾ·ֲ䡣
+ */
+static void EvaluateIcwItems(ICWITEMSET *icw_items, int beam_width)
+{
+	NEWICWITEM *prev_items[ICW_MAX_WORD_LENGTH * ICW_MAX_CI_ITEMS];
+	NEWICWITEM *items, *prev;
+	ICWGROUPITEM *group;
+	int i, j, k, group_no, prev_group_no, prev_count;
+	double value;
+
+	for (group_no = 0; group_no < icw_items->group_count; group_no++)
+	{
+		group = &icw_items->group_item[group_no];
+		if (group->evaluated_count >= group->count)
 			continue;
-		}
 
-		//ںҳֵ
-		next_items = icw_items->group_item[next_group_no].item;
-		next_count = icw_items->group_item[next_group_no].count;
-		max_value = -1.0;
-		index = 0;
-		for (j = 0; j < next_count; j++)
+		items = group->item;
+		for (i = group->evaluated_count; i < group->count; i++)
 		{
-			char c1[0x20] = {0};
+			items[i].path_count = 0;
+
+			if (!group_no)			//ʼλãҪ㿪ʼĽ
+				InsertIcwPath(&items[i], beam_width, GetBigramValueByWord(bigram_data, &icw_items->sentence_word, &items[i].word), 0, 0);
+		}
 
-			memcpy(c1, (char*)next_items[j].hz, next_items[j].length * 2);
-			//strncpy_s(ci1, sizeof(ci1), (char*)next_items[j].hz, next_items[j].length * 2);
-			Utf16ToAnsi((TCHAR*)c1, ci1, sizeof(ci1));
+		//ҳڱ֮ǰ
+		prev_count = 0;
+		for (prev_group_no = max(0, group_no - ICW_MAX_WORD_LENGTH); prev_group_no < group_no; prev_group_no++)
+			for (j = 0; j < icw_items->group_item[prev_group_no].count; j++)
+				if (prev_group_no + icw_items->group_item[prev_group_no].item[j].length == group_no)
+					prev_items[prev_count++] = &icw_items->group_item[prev_group_no].item[j];
 
-			value = GetBigramValue(bigram_data, ci0, ci1);
-			value *= next_items[j].value;
-			if (value > max_value)
+		for (i = group->evaluated_count; i < group->count; i++)
+		{
+			for (j = 0; j < prev_count; j++)
 			{
-				index = j;
-				max_value = value;
+				prev  = prev_items[j];
+				value = GetBigramValueByWord(bigram_data, &prev->word, &items[i].word);
+
+				//ǰ·ɴСУһûм룬Ҳ
+				for (k = 0; k < prev->path_count; k++)
+					if (!InsertIcwPath(&items[i], beam_width, value * prev->path[k].value, prev, k))
+						break;
 			}
 		}
-		items[i].value = max_value;
-		items[i].next = &next_items[index];
 
-		if (!group_no)				//ʼλãҪ㿪ʼĽ
-			items[i].value *= GetBigramValue(bigram_data, "", ci0);
+		group->evaluated_count = group->count;
 	}
 }
 
-/**	ICWѡ̬滮
+/**	ʿ⡢CachebigramȻøıȫ״̬ʧЧ
  */
-int NewGetIcwCandidates(SYLLABLE *syllable, int syllable_count, CANDIDATE *candidate, double *max_value)
+static void CheckIcwStates(int beam_width)
 {
-	int i, index, part_syllable_count;
-//	ICWITEMSET icw_items;
-	ICWITEMSET *icw_items;					//Ϊ˱ջԽĴ󣬱ڶзķʽ 2008-03-06.
+	int i;
 
-	NEWICWITEM	*icw_item;
-	HZ *icw_hz;
-	SYLLABLE *icw_syllable;
+	if (icw_state_version == share_segment->candidate_data_version &&
+		icw_state_bigram == bigram_data &&
+		icw_state_beam_width == beam_width &&
+		!memcmp(&icw_state_config, pim_config, sizeof(PIMCONFIG)))
+		return;
 
-	//ȸֵ⺯0ʱ*max_valueûгʼ
-	*max_value = -1.0;
+	for (i = 0; i < ICW_MAX_STATES; i++)
+		icw_states[i].valid_count = 0;
+
+	icw_state_version	 = share_segment->candidate_data_version;
+	icw_state_bigram	 = bigram_data;
+	icw_state_beam_width = beam_width;
+	memcpy(&icw_state_config, pim_config, sizeof(PIMCONFIG));
+}
+
+/**	ҳڴǰ׺״̬ûʱʹûʹõ״̬
+ *	
+ *		syllable			
+ *		syllable_count		Ŀ
+ *		same_count			ǰ׺Ŀ
+ *	أ
+ *		״̬
+ */
+static ICWSTATE *GetIcwState(SYLLABLE *syllable, int syllable_count, int *same_count)
+{
+	ICWSTATE *state, *best = 0;
+	int i, prefix, best_prefix = -1;
+
+	for (i = 0; i < ICW_MAX_STATES; i++)
+	{
+		state = &icw_states[i];
+
+		prefix = 0;
+		if (state->valid_count)
+			while (prefix < state->syllable_count && prefix < syllable_count &&
+				   !memcmp(&state->syllable[prefix], &syllable[prefix], sizeof(SYLLABLE)))
+				prefix++;
+
+		if (prefix > best_prefix || (prefix == best_prefix && state->last_used < best->last_used))
+		{
+			best		= state;
+			best_prefix = prefix;
+		}
+	}
+
+	best->last_used = ++icw_state_clock;
+	*same_count		= best_prefix;
+
+	return best;
+}
+
+/**	ڵICW·ʱ0
+ *	ICW״̬УҪͷţڱ仯ʱֻµǵ·
+ */
+static ICWSTATE *MakeIcwItems(SYLLABLE *syllable, int syllable_count, int beam_width)
+{
+	int i, part_syllable_count, same_count;
+	ICWSTATE *state;
 
 	if (!bigram_data || syllable_count < 2 || syllable_count > MAX_ICW_LENGTH)
 		return 0;
@@ -351,67 +648,257 @@ int NewGetIcwCandidates(SYLLABLE *syllable, int syllable_count, CANDIDATE *candi
 	if (part_syllable_count >= ICW_MAX_PART_SYLLABLES)
 		return 0;
 
+	CheckIcwStates(beam_width);
+
+	state = GetIcwState(syllable, syllable_count, &same_count);
+	if (!state->icw_items)
+	{
+		//Ϊ˱ջԽĴ󣬱ڶзķʽ 2008-03-06.
+		state->icw_items = malloc(sizeof(ICWITEMSET));
+		if (!state->icw_items)
+			return 0;
+
+		state->valid_count = 0;
+	}
+
 	//icwʲҪģҪpim_configλ
 	SaveCiOption();
+	state->valid_count = GenerateICWItems(state->icw_items, syllable, syllable_count, state->valid_count, same_count);
+	RestoreCiOption();
+
+	memcpy(state->syllable, syllable, sizeof(SYLLABLE) * syllable_count);
+	state->syllable_count = syllable_count;
 
-	icw_items = malloc(sizeof(ICWITEMSET));
-	if (!icw_items)
+	if (state->valid_count < syllable_count)
 		return 0;
 
-	//1. ÿһѡ
-	if (!GenerateICWItems(icw_items, syllable, syllable_count))
+	EvaluateIcwItems(state->icw_items, beam_width);
+
+	return state;
+}
+
+/**	·ɺǰICWѡ
+ */
+static void FillIcwCandidate(const ICWITEMSET *icw_items, const NEWICWITEM *icw_item, int path_no, CANDIDATE *candidate)
+{
+	int i, pos, prev_path;
+
+	pos = icw_items->group_count;
+	while(icw_item)
 	{
-		RestoreCiOption();
-		free(icw_items);
-		return 0;
+		pos -= icw_item->length;
+		for (i = 0; i < icw_item->length; i++)
+		{
+			candidate->icw.hz[pos + i]		 = icw_item->hz[i];
+			candidate->icw.syllable[pos + i] = icw_item->syllable[i];
+		}
+
+		prev_path = icw_item->path[path_no].prev_path;
+		icw_item  = icw_item->path[path_no].prev;
+		path_no   = prev_path;
 	}
 
-	RestoreCiOption();
+	candidate->icw.length = icw_items->group_count;
+	candidate->type = CAND_TYPE_ICW;
+}
+
+/**	ICWѡչֵ뵽Сͬĺѡֵֻģֵͬʱȼǰ
+ */
+static void InsertIcwResult(CANDIDATE *candidate, double *values, int *count, int length, const CANDIDATE *result, double value)
+{
+	int i, pos;
+
+	for (i = 0; i < *count; i++)
+	{
+		if (candidate[i].icw.length == result->icw.length &&
+			!memcmp(candidate[i].icw.hz, result->icw.hz, result->icw.length * sizeof(HZ)))
+			break;
+	}
+
+	if (i < *count)
+	{
+		if (value <= values[i])
+			return;
+
+		//ɾֵСͬѡ
+		memmove(candidate + i, candidate + i + 1, sizeof(CANDIDATE) * (*count - i - 1));
+		memmove(values + i, values + i + 1, sizeof(double) * (*count - i - 1));
+		(*count)--;
+	}
 
-	//2. ÿһļֵ
-	for (i = icw_items->group_count - 1; i >= 0; i--)
-		NewEvaluateGroup(icw_items, i);
+	if (*count == length && value <= values[length - 1])
+		return;
 
-	//3. ֵ
-	index = 0;
-	for (i = 0; i < icw_items->group_item[0].count; i++)
+	for (pos = *count; pos > 0 && values[pos - 1] < value; pos--)
+		;
+
+	if (*count < length)
+		(*count)++;
+
+	memmove(candidate + pos + 1, candidate + pos, sizeof(CANDIDATE) * (*count - 1 - pos));
+	memmove(values + pos + 1, values + pos, sizeof(double) * (*count - 1 - pos));
+
+	candidate[pos] = *result;
+	values[pos]	   = value;
+}
+
+/**	һڲֽм뵽ѡ
+ *	أ
+ *		1ICW
+ *		0
+ */
+static int GetIcwCandidatesOfParse(SYLLABLE *syllable, int syllable_count, int beam_width,
+								   CANDIDATE *candidate, double *values, int *count, int length)
+{
+	int i, k, group_no;
+	ICWSTATE *state;
+	ICWITEMSET *icw_items;
+	NEWICWITEM *items;
+	CANDIDATE result;
+	double end_value, value;
+
+	state = MakeIcwItems(syllable, syllable_count, beam_width);
+	if (!state)
+		return 0;
+
+	//λýҳѵ·
+	icw_items = state->icw_items;
+	for (group_no = max(0, icw_items->group_count - ICW_MAX_WORD_LENGTH); group_no < icw_items->group_count; group_no++)
 	{
-		if (icw_items->group_item[0].item[i].value > *max_value)
+		items = icw_items->group_item[group_no].item;
+		for (i = 0; i < icw_items->group_item[group_no].count; i++)
 		{
-			*max_value = icw_items->group_item[0].item[i].value;
-			index = i;
+			if (group_no + items[i].length != icw_items->group_count)
+				continue;
+
+			end_value = GetBigramValueByWord(bigram_data, &items[i].word, &icw_items->sentence_word);
+			for (k = 0; k < items[i].path_count; k++)
+			{
+				//·ɴС
+				value = items[i].path[k].value * end_value;
+				if (*count == length && value <= values[length - 1])
+					break;
+
+				memset(&result, 0, sizeof(result));
+				FillIcwCandidate(icw_items, &items[i], k, &result);
+				InsertIcwResult(candidate, values, count, length, &result, value);
+			}
 		}
 	}
 
-	//4. candidate
-	icw_item = &icw_items->group_item[0].item[index];
-	i = 0;
-	icw_hz = candidate->icw.hz;
-	icw_syllable = candidate->icw.syllable;
-	while(i < icw_items->group_count && icw_item)
+	return 1;
+}
+
+/**	öڲֵICWѡÿһֲֽһμȫչֵϲ
+ *	ֲֵĿԼڱ߽粻ͬICWڷ飬ܷͬһƥУ
+ *	ֵͬǰ׺ʱ״̬ǰ׺ֵԼ·¼㡣
+ *	Bigramֵÿһһ·õľȫѵ·ֻҪһѡʱ
+ *	ʹ1ҪѡʱŰñ·
+ *	
+ *		syllables			ֲֵ
+ *		syllable_counts		ֲֵĿ
+ *		parse_count			ֵĿ
+ *		candidate			ѡ
+ *		candidate_length	ѡ鳤
+ *	أ
+ *		ICWѡĿ
+ */
+int GetIcwCandidatesOfParses(SYLLABLE **syllables, const int *syllable_counts, int parse_count, CANDIDATE *candidate, int candidate_length)
+{
+	int i, j, count = 0;
+	int beam_width = GetIcwBeamWidth();
+	double values[MAX_ICW_CANDIDATES];
+
+	if (candidate_length > pim_config->icw_candidate_count)
+		candidate_length = pim_config->icw_candidate_count;
+
+	if (candidate_length > MAX_ICW_CANDIDATES)
+		candidate_length = MAX_ICW_CANDIDATES;
+
+	if (candidate_length <= 0)
+		return 0;
+
+	if (candidate_length == 1)
+		beam_width = 1;
+
+	for (i = 0; i < parse_count; i++)
+		GetIcwCandidatesOfParse(syllables[i], syllable_counts[i], beam_width, candidate, values, &count, candidate_length);
+
+	if (show_icw_info)
 	{
-		for (i = 0; i < icw_item->length; i++)
+		for (i = 0; i < count; i++)
 		{
-			*icw_hz++ = icw_item->hz[i];
-			if (show_icw_info)
-				OutputHz(icw_item->hz[i]);
+			for (j = 0; j < candidate[i].icw.length; j++)
+				OutputHz(candidate[i].icw.hz[j]);
 
-			*icw_syllable++ = icw_item->syllable[i];
+			printf("\t%6.8g\n", values[i]);
 		}
+	}
 
-		if (show_icw_info)
-			printf(".");
+	return count;
+}
 
-		icw_item = icw_item->next;
-	}
+/**	ICWѡ̬滮
+ */
+int NewGetIcwCandidates(SYLLABLE *syllable, int syllable_count, CANDIDATE *candidate, double *max_value)
+{
+	int count = 0;
 
-	if (show_icw_info)
-		printf("\n");
+	//ȸֵ⺯0ʱ*max_valueûгʼ
+	*max_value = -1.0;
 
-	candidate->icw.length = icw_items->group_count;
-	candidate->type = CAND_TYPE_ICW;
+	GetIcwCandidatesOfParse(syllable, syllable_count, 1, candidate, max_value, &count, 1);
+
+	return count;
+}
+
+/**	ȫ·һιֵʱ¼
+ */
+static void ClearIcwPaths(ICWITEMSET *icw_items)
+{
+	int i;
+
+	for (i = 0; i < icw_items->group_count; i++)
+		icw_items->group_item[i].evaluated_count = 0;
+}
+
+/**	ͬµĽʱ䣨ڰطŵı棩
+ *	
+ *		syllable			
+ *		syllable_count		Ŀ
+ *		times				ÿһּȽĴ
+ *		ticks				ۼÿһּȵĽʱ䣨߾ȼ±Ϊȣ0
+ *	أ
+ *		ɹ1
+ *		ʣ0
+ */
+int MeasureIcwBeamWidths(SYLLABLE *syllable, int syllable_count, int times, LONGLONG *ticks)
+{
+	LARGE_INTEGER start, end;
+	int i, beam_width;
+	ICWSTATE *state;
+
+	state = MakeIcwItems(syllable, syllable_count, GetIcwBeamWidth());
+	if (!state)
+		return 0;
+
+	for (beam_width = 1; beam_width <= ICW_MAX_BEAM_WIDTH; beam_width++)
+	{
+		QueryPerformanceCounter(&start);
+		for (i = 0; i < times; i++)
+		{
+			ClearIcwPaths(state->icw_items);
+			EvaluateIcwItems(state->icw_items, beam_width);
+		}
+
+		QueryPerformanceCounter(&end);
+		ticks[beam_width] += end.QuadPart - start.QuadPart;
+	}
+
+	//ָõļµ·
+	ClearIcwPaths(state->icw_items);
+	EvaluateIcwItems(state->icw_items, GetIcwBeamWidth());
 
-	free(icw_items);
 	return 1;
 }
 
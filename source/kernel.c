@@ -4,6 +4,7 @@
  *	3. ƵƵĸ¹
  */
 #include <assert.h>
+#include <stdlib.h>
 #include <kernel.h>
 #include <syllable.h>
 #include <config.h>
@@ -18,10 +19,273 @@
 //#include <url.h>
 #include <tchar.h>
 #include <editor.h>
+#include <replay.h>
 
 #define	MIN_LETTER_WORD_POS		5		//Сĵĸʵλ
 
 int		window_logon = 0;				//ϵͳ¼״̬
+int		candidate_top_count = 0;		//ѡֻҪźõĿ0Ϊȫ
+int		candidate_incomplete = 0;		//λúѡΪʱûȫ
+
+static LONGLONG candidate_deadline = 0;	//úѡĽֹʱ䣨߾ȼ0Ϊ
+
+/**	ʼúѡļʱʱĽ׶Σִʡ룩ٽУʹѾ
+ *	õĴʣcandidate_incompleteɱ༭䡣
+ *	
+ *		time_limit			ʱƣ룩0Ϊ
+ */
+void BeginCandidateDeadline(int time_limit)
+{
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER now;
+
+	candidate_incomplete = 0;
+	candidate_deadline	 = 0;
+
+	if (time_limit <= 0)
+		return;
+
+	if (!frequency.QuadPart && !QueryPerformanceFrequency(&frequency))
+		return;
+
+	QueryPerformanceCounter(&now);
+	candidate_deadline = now.QuadPart + frequency.QuadPart * time_limit / 1000;
+}
+
+/**	úѡļʱ
+ */
+void EndCandidateDeadline()
+{
+	candidate_deadline = 0;
+}
+
+/**	ǷѾúѡʱ
+ */
+int IsCandidateDeadlinePassed()
+{
+	LARGE_INTEGER now;
+
+	if (!candidate_deadline)
+		return 0;
+
+	QueryPerformanceCounter(&now);
+
+	return now.QuadPart >= candidate_deadline;
+}
+
+//ѡĲȽϾʱͨݣʹȫֱ룩
+typedef struct tagCANDIDATESORT
+{
+	CANDIDATE	*candidate_array;									//ĺѡ
+	int			(*compare)(const CANDIDATE*, const CANDIDATE*);		//ѡȽϺ
+}CANDIDATESORT;
+
+/**	ȽѡѡͬʱԭĴ
+ */
+static int CompareCandidateHandle(const CANDIDATESORT *sort, CANDIDATEHANDLE handle1, CANDIDATEHANDLE handle2)
+{
+	int ret = sort->compare(&sort->candidate_array[handle1], &sort->candidate_array[handle2]);
+
+	return ret ? ret : handle1 - handle2;
+}
+
+/**	Ժѡй鲢qsortıȽϺܴ
+ *	
+ *		sort				
+ *		handles				ѡ
+ *		temp				ʱcount / 2
+ *		count				Ŀ
+ */
+static void SortCandidateHandles(const CANDIDATESORT *sort, CANDIDATEHANDLE *handles, CANDIDATEHANDLE *temp, int count)
+{
+	int half = count / 2;
+	int i, j, k;
+
+	if (count < 2)
+		return;
+
+	SortCandidateHandles(sort, handles, temp, half);
+	SortCandidateHandles(sort, handles + half, temp, count - half);
+
+	//ǰһ븴Ƶʱһϲԭλ
+	memcpy(temp, handles, sizeof(CANDIDATEHANDLE) * half);
+	for (i = 0, j = half, k = 0; i < half; k++)
+	{
+		if (j < count && CompareCandidateHandle(sort, handles[j], temp[i]) < 0)
+			handles[k] = handles[j++];
+		else
+			handles[k] = temp[i++];
+	}
+}
+
+/**	ʱʹõĶѣΪѡĺѡһ
+ */
+static void SiftTopCandidateHeap(const CANDIDATESORT *sort, CANDIDATEHANDLE *heap, int heap_count, int pos)
+{
+	int child, temp;
+
+	while ((child = pos * 2 + 1) < heap_count)
+	{
+		if (child + 1 < heap_count && CompareCandidateHandle(sort, heap[child + 1], heap[child]) > 0)
+			child++;
+
+		if (CompareCandidateHandle(sort, heap[child], heap[pos]) <= 0)
+			break;
+
+		temp		= heap[pos];
+		heap[pos]	= heap[child];
+		heap[child] = temp;
+		pos			= child;
+	}
+}
+
+/**	վĴкѡÿѡֻΣƵʱԼƻ
+ *	
+ *		candidate_array		ѡ
+ *		handles				źôĺѡcountÿѡһ
+ *		count				ѡĿ
+ *	أ
+ *		ɹ1
+ *		ʧܣ0
+ */
+int ArrangeCandidates(CANDIDATE *candidate_array, const CANDIDATEHANDLE *handles, int count)
+{
+	TEMPMEMORYMARK mark = GetTempMemoryMark();
+	CANDIDATE *temp;
+	int i;
+
+	temp = AllocateTempMemory(sizeof(CANDIDATE) * count);
+	if (!temp)
+		return 0;
+
+	for (i = 0; i < count; i++)
+		temp[i] = candidate_array[handles[i]];
+
+	memcpy(candidate_array, temp, sizeof(CANDIDATE) * count);
+	FreeTempMemory(mark);
+
+	return 1;
+}
+
+/**	ѡĺѡվĴŵǰ滻ĺѡŵѡĺѡԭλ
+ *	
+ *		candidate_array		ѡ
+ *		heap				źôѡĺѡ
+ *		top_count			ѡĺѡĿ
+ *	أ
+ *		ɹ1
+ *		ʧܣ0
+ */
+int ArrangeTopCandidates(CANDIDATE *candidate_array, const CANDIDATEHANDLE *heap, int top_count)
+{
+	TEMPMEMORYMARK mark = GetTempMemoryMark();
+	CANDIDATE *temp;
+	char *selected;
+	int i, j;
+
+	temp	 = AllocateTempMemory(sizeof(CANDIDATE) * top_count);
+	selected = AllocateTempMemory(top_count);
+	if (!temp || !selected)
+	{
+		FreeTempMemory(mark);
+		return 0;
+	}
+
+	memset(selected, 0, top_count);
+	for (i = 0; i < top_count; i++)
+	{
+		temp[i] = candidate_array[heap[i]];
+		if (heap[i] < top_count)
+			selected[heap[i]] = 1;
+	}
+
+	//ǰûбѡеĺѡƶ󲿱ѡеĺѡλ
+	for (i = 0, j = 0; i < top_count; i++)
+	{
+		if (heap[i] < top_count)
+			continue;
+
+		while (selected[j])
+			j++;
+
+		candidate_array[heap[i]] = candidate_array[j++];
+	}
+
+	memcpy(candidate_array, temp, sizeof(CANDIDATE) * top_count);
+	FreeTempMemory(mark);
+
+	return 1;
+}
+
+/**	Ժѡ
+ *	ֻںѡѡλãϽУźúÿѡֻƶһΣqsortѡṹ
+ *	candidate_top_countΪ0Һѡ϶ʱֻǰcandidate_top_countѡѡ
+ *	ѡ񣬱ȽϴԼΪѡĿŵǰѡĴȷ
+ *	
+ *		candidate_array		ѡ
+ *		count				ѡĿ
+ *		compare				ѡȽϺ
+ */
+void PartialSortCandidates(CANDIDATE *candidate_array, int count, int (*compare)(const CANDIDATE*, const CANDIDATE*))
+{
+	TEMPMEMORYMARK mark = GetTempMemoryMark();
+	CANDIDATEHANDLE *handles, heap[CANDIDATE_TOP_COUNT], heap_temp[CANDIDATE_TOP_COUNT / 2];
+	CANDIDATESORT sort;
+	int top_count = candidate_top_count;
+	int i, ok;
+
+	if (count < 2)
+		return;
+
+	sort.candidate_array = candidate_array;
+	sort.compare		 = compare;
+
+	if (!top_count || top_count > CANDIDATE_TOP_COUNT || count <= top_count)
+	{
+		//벿Ϊ鲢ʱ
+		handles = AllocateTempMemory(sizeof(CANDIDATEHANDLE) * (count + count / 2));
+		if (handles)
+		{
+			for (i = 0; i < count; i++)
+				handles[i] = i;
+
+			SortCandidateHandles(&sort, handles, handles + count, count);
+			ok = ArrangeCandidates(candidate_array, handles, count);
+		}
+		else
+			ok = 0;
+
+		FreeTempMemory(mark);
+
+		//ʱڴ治ʱֱӶԺѡ
+		if (!ok)
+			qsort(candidate_array, count, sizeof(CANDIDATE), (int (*)(const void*, const void*))compare);
+
+		return;
+	}
+
+	//ѡǰtop_countѡ
+	for (i = 0; i < top_count; i++)
+		heap[i] = i;
+
+	for (i = top_count / 2 - 1; i >= 0; i--)
+		SiftTopCandidateHeap(&sort, heap, top_count, i);
+
+	for (i = top_count; i < count; i++)
+	{
+		if (CompareCandidateHandle(&sort, i, heap[0]) >= 0)
+			continue;
+
+		heap[0] = i;
+		SiftTopCandidateHeap(&sort, heap, top_count, 0);
+	}
+
+	SortCandidateHandles(&sort, heap, heap_temp, top_count);
+
+	//ʱڴ治ʱֱӶȫѡ
+	if (!ArrangeTopCandidates(candidate_array, heap, top_count))
+		qsort(candidate_array, count, sizeof(CANDIDATE), (int (*)(const void*, const void*))compare);
+}
 
 /**	ԺѡҪĿҪõڵĴֺ
  */
@@ -217,58 +481,62 @@ void SortWildcardCandidates(PIMCONTEXT *context, CANDIDATE *candidate_array, int
 	return;
 }
 
-int UnifyCandidates(PIMCONTEXT *context, CANDIDATE *candidate_array, int count, int spw_count)
+/**	֡ʺѡĺִ
+ *	أ
+ *		ִȣ֡ʺѡʱ0
+ */
+static int GetCandidateHZString(CANDIDATE *candidate, const TCHAR **string)
 {
-	int i, j, k, ret;
-
-	for (i = 0; i < spw_count; i++)
+	switch (candidate->type)
 	{
-		if (candidate_array[i].type != CAND_TYPE_SPW && candidate_array[i].spw.type != SPW_STRING_NORMAL)
-			continue;
-
-		for (j = spw_count; j < count; j++)
+	case CAND_TYPE_ZI:
+		if (candidate->hz.is_word)
 		{
-			ret = 0;
+			*string = GetItemHZPtr(candidate->hz.word_item);
+			return candidate->hz.word_item->ci_length;
+		}
 
-			switch (candidate_array[j].type)
-			{
-			case CAND_TYPE_ZI:
-				if (candidate_array[j].hz.is_word)
-				{
-					if (candidate_array[j].hz.word_item->ci_length == candidate_array[i].spw.length)
-						ret = !_tcsncmp(candidate_array[i].spw.string,
-										GetItemHZPtr(candidate_array[j].hz.word_item),
-										candidate_array[i].spw.length);
-				}
-				else if (1 == candidate_array[i].spw.length)
-					ret = !_tcsncmp(candidate_array[i].spw.string,
-									&(TCHAR)candidate_array[j].hz.item->hz,
-									1);
+		*string = (const TCHAR*)&candidate->hz.item->hz;
+		return 1;
 
-				break;
+	case CAND_TYPE_CI:
+		*string = candidate->word.hz;
+		return candidate->word.item->ci_length;
+	}
 
-			case CAND_TYPE_CI:
-				if (candidate_array[j].word.item->ci_length == candidate_array[i].spw.length)
-					ret = !_tcsncmp(candidate_array[i].spw.string,
-									candidate_array[j].word.hz,
-									candidate_array[i].spw.length);
+	return 0;
+}
 
-				break;
-			}
+/**	ɾͬ֡ʺѡ
+ *	һαѡÿѡֻ볤ͬĶȽϣɾʱƶĺѡ
+ *	أ
+ *		غĺѡĿ
+ */
+int UnifyCandidates(PIMCONTEXT *context, CANDIDATE *candidate_array, int count, int spw_count)
+{
+	const TCHAR *string;
+	int i, j, length, new_count;
 
-			if (ret)
-			{
-				//ӺǰŲ
-				for (k = j; k < count - 1; k++)
-					candidate_array[k] = candidate_array[k + 1];
+	for (new_count = j = spw_count; j < count; j++)
+	{
+		length = GetCandidateHZString(&candidate_array[j], &string);
 
-				count--;
-				j--;
-			}
+		for (i = 0; length && i < spw_count; i++)
+		{
+			if (candidate_array[i].type != CAND_TYPE_SPW && candidate_array[i].spw.type != SPW_STRING_NORMAL)
+				continue;
+
+			if (candidate_array[i].spw.length == length && !_tcsncmp(candidate_array[i].spw.string, string, length))
+				break;
 		}
+
+		if (length && i < spw_count)		//ͬ
+			continue;
+
+		candidate_array[new_count++] = candidate_array[j];
 	}
 
-	return count;
+	return new_count;
 }
 
 //ж϶ǲںѡλ
@@ -344,10 +612,11 @@ int GetCandidates(PIMCONTEXT *context,
 	//ƴȹӦųʵʲֽһ2^k)otherı
 	//ƣֻԵĽ(ΪҲҪʹСڲֵĽ
 	//ҪʹãFULL_CIΪСڲ䲻ͬڴ棬໥)
-	SYLLABLE *small_syllables_arrays = (SYLLABLE*)malloc((2 << MAX_SMALL_SYLLABLES) * MAX_SYLLABLE_PER_INPUT * sizeof(SYLLABLE));
-	SYLLABLE *small_other_syllables_arrays = (SYLLABLE*)malloc((2 << MAX_SMALL_SYLLABLES) * MAX_SYLLABLE_PER_INPUT * sizeof(SYLLABLE));
-	int *small_arrays_lengths = (int*)malloc((2 << MAX_SMALL_SYLLABLES) * sizeof(int));
-	int *small_other_arrays_lengths = (int*)malloc((2 << MAX_SMALL_SYLLABLES) * sizeof(int));
+	//Щʱڴз䣬õѡ(MakeCandidate)һȫͷţ;ʱҪͷ
+	SYLLABLE *small_syllables_arrays = (SYLLABLE*)AllocateTempMemory((2 << MAX_SMALL_SYLLABLES) * MAX_SYLLABLE_PER_INPUT * sizeof(SYLLABLE));
+	SYLLABLE *small_other_syllables_arrays = (SYLLABLE*)AllocateTempMemory((2 << MAX_SMALL_SYLLABLES) * MAX_SYLLABLE_PER_INPUT * sizeof(SYLLABLE));
+	int *small_arrays_lengths = (int*)AllocateTempMemory((2 << MAX_SMALL_SYLLABLES) * sizeof(int));
+	int *small_other_arrays_lengths = (int*)AllocateTempMemory((2 << MAX_SMALL_SYLLABLES) * sizeof(int));
 	int small_arrays_count = 0;
 	int small_other_arrays_count = 0;
 
@@ -610,15 +879,7 @@ int GetCandidates(PIMCONTEXT *context,
 		SortCiCandidates(candidate_array + last_count, count - last_count);
 
 		if (count >= array_length)
-		{
-			//ǰͷ
-			free(small_syllables_arrays);
-			free(small_other_syllables_arrays);
-			free(small_arrays_lengths);
-			free(small_other_arrays_lengths);
-
 			return array_length;
-		}
 	}
 
 	if (!has_star)
@@ -634,136 +895,55 @@ int GetCandidates(PIMCONTEXT *context,
 			//ֻһѡںѡλʹ
 			if(!(count == 1 && IsFirstPosSPW(candidate_array)))
 			{ 
-				extern int NewGetIcwCandidates(SYLLABLE *, int, CANDIDATE *, double *);
-
-				int has_icw_candidate = 0;
-				double current_value, max_value;
+				SYLLABLE *parse_syllables[2 + 2 * (2 << MAX_SMALL_SYLLABLES)];
+				int parse_counts[2 + 2 * (2 << MAX_SMALL_SYLLABLES)];
+				int parse_count = 0;
 
 				//ͨ
-				icw_count = NewGetIcwCandidates(new_syllables, new_syllable_count, candidate_array + count, &current_value); //icw_countֻȡ01
-				has_icw_candidate = icw_count; //һڽʺѡֵΪ1
-				max_value = current_value;
-				count += icw_count;
+				parse_syllables[parse_count] = new_syllables;
+				parse_counts[parse_count++]	 = new_syllable_count;
 
 				//Сڲ
 				for (i = 0; i < small_arrays_count; i++)
 				{
-					icw_count = NewGetIcwCandidates(small_syllables_arrays + i * MAX_SYLLABLE_PER_INPUT,
-						small_arrays_lengths[i], candidate_array + count, &current_value);
-
-					//֮ǰǷкѡ
-					if (!has_icw_candidate)
-					{
-						if (icw_count)
-						{
-							has_icw_candidate = icw_count;
-							count += icw_count;
-						}
-					}
-					else
-					{
-						//֮ǰǰѡڵ
-						if (icw_count)
-						{
-							//ȡʽϴ
-							if (current_value > max_value)
-							{
-								max_value = current_value;
-								candidate_array[count - 1] = candidate_array[count];
-							}
-
-							//յcandidate_arrayֻһʽ
-							//ڼ֮ǰѡʱcountѾ1ﲻcount--
-						}
-					}
+					parse_syllables[parse_count] = small_syllables_arrays + i * MAX_SYLLABLE_PER_INPUT;
+					parse_counts[parse_count++]	 = small_arrays_lengths[i];
 				}
 
 				//ͨ
 				if (other_count)
 				{
-					icw_count = NewGetIcwCandidates(other_syllables, other_count, candidate_array + count, &current_value);
-
-					//֮ǰǷкѡ
-					if (!has_icw_candidate)
-					{
-						if (icw_count)
-						{
-							has_icw_candidate = icw_count;
-							count += icw_count;
-						}
-					}
-					else
-					{
-						//֮ǰǰѡڵ
-						if (icw_count)
-						{
-							//ȡʽϴ
-							if (current_value > max_value)
-							{
-								max_value = current_value;
-								candidate_array[count - 1] = candidate_array[count];
-							}
-
-							//յcandidate_arrayֻһʽ
-							//ڼ֮ǰѡʱcountѾ1ﲻcount--
-						}
-					}
+					parse_syllables[parse_count] = other_syllables;
+					parse_counts[parse_count++]	 = other_count;
 
 					//Сڲ
 					for (i = 0; i < small_other_arrays_count; i++)
 					{
-						icw_count = NewGetIcwCandidates(small_other_syllables_arrays + i * MAX_SYLLABLE_PER_INPUT,
-							small_other_arrays_lengths[i], candidate_array + count, &current_value);
-
-						//֮ǰǷкѡ
-						if (!has_icw_candidate)
-						{
-							if (icw_count)
-							{
-								has_icw_candidate = icw_count;
-								count += icw_count;
-							}
-						}
-						else
-						{
-							//֮ǰǰѡڵ
-							if (icw_count)
-							{
-								//ȡʽϴ
-								if (current_value > max_value)
-								{
-									max_value = current_value;
-									candidate_array[count - 1] = candidate_array[count];
-								}
-
-								//յcandidate_arrayֻһʽ
-								//ڼ֮ǰѡʱcountѾ1ﲻcount--
-							}
-						}
+						parse_syllables[parse_count] = small_other_syllables_arrays + i * MAX_SYLLABLE_PER_INPUT;
+						parse_counts[parse_count++]	 = small_other_arrays_lengths[i];
 					}
 				}
 
-				if (count >= array_length)
-				{
-					//ǰͷ
-					free(small_syllables_arrays);
-					free(small_other_syllables_arrays);
-					free(small_arrays_lengths);
-					free(small_other_arrays_lengths);
+				//ȫһʣոʴӴСɸʽ
+				REPLAY_STAGE_BEGIN(REPLAY_STAGE_ICW);
+				icw_count = GetIcwCandidatesOfParses(parse_syllables, parse_counts, parse_count, candidate_array + count, array_length - count);
+				REPLAY_STAGE_END(REPLAY_STAGE_ICW);
+				count += icw_count;
 
+				if (count >= array_length)
 					return array_length; 
-				}
 			}
 		}
 
-		//Ƿʹ˽ʣsmall_syllables_arrayssmall_arrays_lengths
-		//涼ˣӦͷ(עⲻҪͷţΪ;кܶreturn)
-		free(small_syllables_arrays);
-		free(small_other_syllables_arrays);
-		free(small_arrays_lengths);
-		free(small_other_arrays_lengths);
-
 		//4. PART_CI
+		//ĲִһδӴʿȫճȷƥ񣩣ÿȲٲҴʿ
+		if (!IsCandidateDeadlinePassed())
+			PrepareCiPrefixCandidates(
+				new_syllables,
+				new_syllable_count - 1,
+				2,
+				context->selected_item_count || context->state == STATE_IEDIT ? 1 : 0);
+
 		for (i = new_syllable_count/*syllable_count*/ - 1; i >= 2; i--)
 		{
 			int other_count;
@@ -822,6 +1002,13 @@ int GetCandidates(PIMCONTEXT *context,
 
 			if (count >= array_length)
 				return array_length;
+
+			//ʱٲҸ̵ĲִʣѾҵĳڴƥУʱܿõ
+			if (i > 2 && IsCandidateDeadlinePassed())
+			{
+				candidate_incomplete = 1;
+				break;
+			}
 		}
 
 		//5. ZI
@@ -943,16 +1130,6 @@ int GetCandidates(PIMCONTEXT *context,
 				return array_length;
 		}
 	}
-	else
-	{
-		//ܽʣôsmall_syllables_arrayssmall_arrays_lengths
-		//ͷ(עⲻҪͷţΪ;кܶreturn)
-		free(small_syllables_arrays);
-		free(small_other_syllables_arrays);
-		free(small_arrays_lengths);
-		free(small_other_arrays_lengths);
-	}
-
 
 	//6. Ӣĵ
 	//QӢĵʺ͵0ек
@@ -1001,7 +1178,13 @@ int GetCandidates(PIMCONTEXT *context,
 			new_syllables[syllable_count].con  = CON_ANY;
 			new_syllables[syllable_count].vow  = VOW_ANY;
 			new_syllables[syllable_count].tone = TONE_0;
-			wildcard_count = ProcessCiCandidate(new_syllables, syllable_count + 1, 0, new_candidates, MAX_ICW_CANDIDATES, 0);
+
+			//ͨҽʱٽ
+			if (IsCandidateDeadlinePassed())
+				candidate_incomplete = 1;
+			else
+				wildcard_count = ProcessCiCandidate(new_syllables, syllable_count + 1, 0, new_candidates, MAX_ICW_CANDIDATES, 0);
+
 			for (i = 0; i < pim_config->suggest_word_count && i < wildcard_count; i++)
 			{
 				candidate_array[count] = new_candidates[i];
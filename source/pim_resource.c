@@ -340,6 +340,8 @@ int FreeEnglishResource()
 
 int PIM_ReloadEnglishResource()
 {
+	share_segment->candidate_data_version++;
+
 	FreeEnglishResource();
 	LoadEnglishResource();
 
@@ -368,6 +370,8 @@ int FreeEnglishTransResource()
 
 int PIM_ReloadEnglishTransResource()
 {
+	share_segment->candidate_data_version++;
+
 	FreeEnglishTransResource();
 	LoadEnglishTransResource();
 
@@ -376,6 +380,8 @@ int PIM_ReloadEnglishTransResource()
 
 int PIM_ReloadEnglishAllResource()
 {
+	share_segment->candidate_data_version++;
+
 	FreeEnglishResource();
 	LoadEnglishResource();
 
@@ -407,6 +413,8 @@ int FreeBHResource()
 
 int WINAPI PIM_ReloadBHResource()
 {
+	share_segment->candidate_data_version++;
+
 	FreeBHResource();
 	LoadBHResource();
 	return 1;
@@ -416,6 +424,8 @@ int WINAPI PIM_ReloadBHResource()
  */
 int PIM_FreeResources()
 {
+	share_segment->candidate_data_version++;
+
 	if (!share_segment->resource_loaded)
 		return 1;
 
@@ -455,6 +465,8 @@ int PIM_SaveResources()
  */
 int PIM_LoadResources()
 {
+	share_segment->candidate_data_version++;
+
 	LoadWordLibraryResource();			//ʿ
 	LoadBigramResource();				//Bigram
 
@@ -493,6 +505,8 @@ int PIM_ReloadResources()
  */
 int PIM_ReloadINIResource()
 {
+	share_segment->candidate_data_version++;
+
 	FreeSpwResource();
 	FreeTopZiResource();
 	FreeSymbolResource();
@@ -510,6 +524,8 @@ int PIM_ReloadINIResource()
  */
 int PIM_ReloadWordlibResource()
 {
+	share_segment->candidate_data_version++;
+
 	LoadWordLibraryResource();			//ʿ
 
 	return 1;
@@ -517,6 +533,8 @@ int PIM_ReloadWordlibResource()
 
 int PIM_ForceReloadWordlibResource()
 {
+	share_segment->candidate_data_version++;
+
 	CloseAllWordLibrary();
 	LoadWordLibraryResource();			//ʿ
 
@@ -527,6 +545,8 @@ int PIM_ForceReloadWordlibResource()
  */
 int WINAPI PIM_ReloadZiResource()
 {
+	share_segment->candidate_data_version++;
+
 	FreeHZDataResource();
 	LoadHZDataResource();
 
@@ -0,0 +1,508 @@
+/*	طģ顣
+ *	ıļжȡУÿһ룩ProcessKeyͳÿһΰ
+ *	Լƴúѡʡѡַ׶εĺʱp50/p99/maxΪ
+ *	޸ǰȽϵĻ׼ѡΪʱûȫʱ֮Ĳ䵥ʱ
+ *	лȽ˳ʹù߳»úѡĺʱԼÿڲͬ
+ *	ʼµĽʱ䡣
+ *	Ҳڼʹù̻߳õĺѡ˳õĺѡǷͬ
+ *
+ *	ļʽUTF-16
+ *		#ע
+ *		zhongguorenmin{SPACE}
+ *		nihao{BACK}{BACK}ao{RETURN}
+ *	ֱַͨΪ{}Ϊÿһнġ
+ */
+#include <tchar.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <windows.h>
+#include <kernel.h>
+#include <context.h>
+#include <editor.h>
+#include <icw.h>
+#include <config.h>
+#include <pim_state.h>
+#include <utility.h>
+#include <share_segment.h>
+#include <worker_pool.h>
+#include <replay.h>
+
+int replay_running = 0;
+
+static LARGE_INTEGER stage_start[REPLAY_STAGE_COUNT];
+static LONGLONG stage_ticks[REPLAY_STAGE_COUNT];
+
+//
+static const struct
+{
+	const TCHAR	*name;
+	int			virtual_key;
+	TCHAR		ch;
+} replay_keys[] =
+{
+	{ TEXT("{SPACE}"),		VK_SPACE,		' '	 },
+	{ TEXT("{BACK}"),		VK_BACK,		0x8	 },
+	{ TEXT("{RETURN}"),		VK_RETURN,		0xd	 },
+	{ TEXT("{ESCAPE}"),		VK_ESCAPE,		0x1b },
+	{ TEXT("{DELETE}"),		VK_DELETE,		0	 },
+	{ TEXT("{LEFT}"),		VK_LEFT,		0	 },
+	{ TEXT("{RIGHT}"),		VK_RIGHT,		0	 },
+	{ TEXT("{HOME}"),		VK_HOME,		0	 },
+	{ TEXT("{END}"),		VK_END,			0	 },
+	{ TEXT("{PRIOR}"),		VK_PRIOR,		0	 },
+	{ TEXT("{NEXT}"),		VK_NEXT,		0	 },
+};
+
+static const TCHAR *stage_names[REPLAY_STAGE_COUNT] =
+{
+	TEXT(""), TEXT("ƴ"), TEXT("úѡ"), TEXT(""), TEXT("ѡַ"), TEXT(""),
+};
+
+/**	׶οʼʱ
+ */
+void ReplayStageBegin(int stage)
+{
+	QueryPerformanceCounter(&stage_start[stage]);
+}
+
+/**	׶νʱͬһΰжνĽ׶ۼƼʱ
+ */
+void ReplayStageEnd(int stage)
+{
+	LARGE_INTEGER now;
+
+	QueryPerformanceCounter(&now);
+	stage_ticks[stage] += now.QuadPart - stage_start[stage].QuadPart;
+}
+
+/**	Ӱлһ
+ *	أ
+ *		ʹõַ0Ϊ
+ */
+static int GetReplayKey(const TCHAR *p, int *virtual_key, TCHAR *ch)
+{
+	int i, length;
+
+	if (!*p || *p == 0xd || *p == 0xa)
+		return 0;
+
+	for (i = 0; i < sizeof(replay_keys) / sizeof(replay_keys[0]); i++)
+	{
+		length = (int)_tcslen(replay_keys[i].name);
+		if (!_tcsncmp(p, replay_keys[i].name, length))
+		{
+			*virtual_key = replay_keys[i].virtual_key;
+			*ch			 = replay_keys[i].ch;
+			return length;
+		}
+	}
+
+	*ch = *p;
+	if (*p >= 'a' && *p <= 'z')
+		*virtual_key = *p - 'a' + 'A';
+	else if ((*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9'))
+		*virtual_key = *p;
+	else
+		*virtual_key = VkKeyScan(*p) & 0xff;
+
+	return 1;
+}
+
+static int CompareTicks(const void *p1, const void *p2)
+{
+	LONGLONG t1 = *(const LONGLONG*)p1, t2 = *(const LONGLONG*)p2;
+
+	return t1 < t2 ? -1 : t1 > t2;
+}
+
+/**	һ׶εĺʱͳƣ΢룩
+ */
+static void OutputStageTicks(FILE *fr, const TCHAR *name, LONGLONG *ticks, int count, LONGLONG frequency)
+{
+	qsort(ticks, count, sizeof(LONGLONG), CompareTicks);
+
+	_ftprintf(fr, TEXT("%s\t%.1f\t%.1f\t%.1f\n"),
+			  name,
+			  1e6 * ticks[(count - 1) * 50 / 100] / frequency,
+			  1e6 * ticks[(count - 1) * 99 / 100] / frequency,
+			  1e6 * ticks[count - 1] / frequency);
+}
+
+/**	ĵĸ»úѡֱѡʱʱǰӺѡ޸ļ
+ *	²Ҵʿ⣬ʹûĽ
+ *	
+ *		context				
+ *		measure_context		ڼʱĸ
+ *		serial				Ƿ˳ãʹụ̀߳
+ *	أ
+ *		ʱ
+ */
+static LONGLONG TimeMakeCandidate(PIMCONTEXT *context, PIMCONTEXT *measure_context, int serial)
+{
+	LARGE_INTEGER start, end;
+
+	memcpy(measure_context, context, sizeof(PIMCONTEXT));
+	share_segment->candidate_data_version++;
+	worker_serial = serial;
+
+	QueryPerformanceCounter(&start);
+	MakeCandidate(measure_context);
+	while (RefineCandidates(measure_context))
+		;
+	QueryPerformanceCounter(&end);
+
+	worker_serial = 0;
+
+	return end.QuadPart - start.QuadPart;
+}
+
+/**	طŰļʱͳд뱨ļ
+ *	
+ *		trace_file_name		ļ
+ *		report_file_name	ļ
+ *	أ
+ *		ɹ1
+ *		ʧܣ0
+ */
+int ReplayKeyTrace(const TCHAR *trace_file_name, const TCHAR *report_file_name)
+{
+	extern int resource_thread_finished;
+	FILE *fr = 0, *fw = 0;
+	PIMCONTEXT *context = 0, *measure_context = 0;
+	LONGLONG *ticks[REPLAY_STAGE_COUNT] = { 0 };
+	LONGLONG *serial_ticks = 0, *parallel_ticks = 0;
+	LARGE_INTEGER frequency, start, end;
+	TCHAR line[REPLAY_MAX_LINE_LENGTH];
+	TCHAR *p;
+	TCHAR ch;
+	LONGLONG beam_ticks[ICW_MAX_BEAM_WIDTH + 1] = { 0 };
+	SYLLABLE line_syllables[MAX_SYLLABLE_PER_INPUT];
+	int line_syllable_count, beam_line_count = 0;
+	int virtual_key, length;
+	int key_count = 0, line_count = 0, incomplete_count = 0, measure_count = 0;
+	int i, ret = 0;
+
+	do
+	{
+		while (!resource_thread_finished)
+			Sleep(0);
+
+		if (!QueryPerformanceFrequency(&frequency))
+		{
+			Log(LOG_ID, L"ָ֧߾ȼʱ");
+			break;
+		}
+
+		fr = _tfopen(trace_file_name, TEXT("rb"));
+		if (!fr)
+		{
+			Log(LOG_ID, L"ļ<%s>޷", trace_file_name);
+			break;
+		}
+
+		fw = _tfopen(report_file_name, TEXT("wt"));
+		if (!fw)
+		{
+			Log(LOG_ID, L"ļ<%s>޷", report_file_name);
+			break;
+		}
+
+		context			= malloc(sizeof(PIMCONTEXT));
+		measure_context = malloc(sizeof(PIMCONTEXT));
+		serial_ticks	= malloc(sizeof(LONGLONG) * REPLAY_MAX_KEYS);
+		parallel_ticks	= malloc(sizeof(LONGLONG) * REPLAY_MAX_KEYS);
+		for (i = 0; i < REPLAY_STAGE_COUNT; i++)
+			if (!(ticks[i] = malloc(sizeof(LONGLONG) * REPLAY_MAX_KEYS)))
+				break;
+
+		if (!context || !measure_context || !serial_ticks || !parallel_ticks || i < REPLAY_STAGE_COUNT)
+		{
+			Log(LOG_ID, L"ڴʧ");
+			break;
+		}
+
+		FirstTimeResetContext(context);
+		context->capital	= 0;
+		context->input_mode = CHINESE_MODE;
+
+		//FFFE
+		fseek(fr, 2, SEEK_SET);
+
+		while (key_count < REPLAY_MAX_KEYS && GetLineFromFile(fr, line, _SizeOf(line)))
+		{
+			if (line[0] == 0 || line[0] == '#' || line[0] == 0xd || line[0] == 0xa)
+				continue;
+
+			line_count++;
+			line_syllable_count = 0;
+			for (p = line; key_count < REPLAY_MAX_KEYS && (length = GetReplayKey(p, &virtual_key, &ch)) > 0; p += length)
+			{
+				memset(stage_ticks, 0, sizeof(stage_ticks));
+
+				replay_running = 1;
+				QueryPerformanceCounter(&start);
+
+				ProcessKey(context, 0, virtual_key, ch);
+
+				QueryPerformanceCounter(&end);
+				replay_running = 0;
+
+				stage_ticks[REPLAY_STAGE_KEY] = end.QuadPart - start.QuadPart;
+
+				//ģʱĲ䣬ֱѡ
+				if (context->candidate_incomplete)
+				{
+					incomplete_count++;
+
+					QueryPerformanceCounter(&start);
+					while (RefineCandidates(context))
+						;
+					QueryPerformanceCounter(&end);
+
+					stage_ticks[REPLAY_STAGE_REFINE] = end.QuadPart - start.QuadPart;
+				}
+
+				for (i = 0; i < REPLAY_STAGE_COUNT; i++)
+					ticks[i][key_count] = stage_ticks[i];
+
+				key_count++;
+
+				//¼ڣڱȽʵļ
+				if (context->syllable_count > line_syllable_count && context->syllable_count <= MAX_SYLLABLE_PER_INPUT)
+				{
+					line_syllable_count = context->syllable_count;
+					memcpy(line_syllables, context->syllables, line_syllable_count * sizeof(SYLLABLE));
+				}
+			}
+
+			ResetContext(context);
+
+			if (MeasureIcwBeamWidths(line_syllables, line_syllable_count, REPLAY_ICW_BEAM_TIMES, beam_ticks))
+				beam_line_count++;
+		}
+
+		//ٻطһ飬ÿΰĵĸзֱ˳Լʹù߳»úѡʱ
+		//밴ļʱֿУӺѡ޸ļʹļʱûлá
+		fseek(fr, 2, SEEK_SET);
+		while (measure_count < REPLAY_MAX_KEYS && GetLineFromFile(fr, line, _SizeOf(line)))
+		{
+			if (line[0] == 0 || line[0] == '#' || line[0] == 0xd || line[0] == 0xa)
+				continue;
+
+			for (p = line; measure_count < REPLAY_MAX_KEYS && (length = GetReplayKey(p, &virtual_key, &ch)) > 0; p += length)
+			{
+				ProcessKey(context, 0, virtual_key, ch);
+				while (RefineCandidates(context))
+					;
+
+				if (!context->candidate_count)
+					continue;
+
+				serial_ticks[measure_count]	  = TimeMakeCandidate(context, measure_context, 1);
+				parallel_ticks[measure_count] = TimeMakeCandidate(context, measure_context, 0);
+				measure_count++;
+			}
+
+			ResetContext(context);
+		}
+
+		_ftprintf(fw, TEXT("%c"), 0xFEFF);
+		_ftprintf(fw, TEXT("У%s\n%d%dʱ%d\n\n"), trace_file_name, line_count, key_count, incomplete_count);
+
+		if (key_count)
+		{
+			_ftprintf(fw, TEXT("׶\tp50(us)\tp99(us)\tmax(us)\n"));
+			for (i = 0; i < REPLAY_STAGE_COUNT; i++)
+				OutputStageTicks(fw, stage_names[i], ticks[i], key_count, frequency.QuadPart);
+		}
+
+		if (measure_count)
+		{
+			_ftprintf(fw, TEXT("\n»úѡ%dΰ߳%d\n"), measure_count, GetWorkerCount());
+			_ftprintf(fw, TEXT("ʽ\tp50(us)\tp99(us)\tmax(us)\n"));
+			OutputStageTicks(fw, TEXT("˳"), serial_ticks, measure_count, frequency.QuadPart);
+			OutputStageTicks(fw, TEXT(""), parallel_ticks, measure_count, frequency.QuadPart);
+		}
+
+		if (beam_line_count)
+		{
+			_ftprintf(fw, TEXT("\nʼȣ%dУÿн%dΣǰ:%d\n"), beam_line_count, REPLAY_ICW_BEAM_TIMES, pim_config->icw_beam_width);
+			_ftprintf(fw, TEXT("\tƽ(us)\n"));
+			for (i = 1; i <= ICW_MAX_BEAM_WIDTH; i++)
+				_ftprintf(fw, TEXT("%d\t%.1f\n"), i, 1e6 * beam_ticks[i] / frequency.QuadPart / (beam_line_count * REPLAY_ICW_BEAM_TIMES));
+		}
+
+		ret = 1;
+	}while(0);
+
+	if (fr)
+		fclose(fr);
+
+	if (fw)
+		fclose(fw);
+
+	for (i = 0; i < REPLAY_STAGE_COUNT; i++)
+		if (ticks[i])
+			free(ticks[i]);
+
+	if (serial_ticks)
+		free(serial_ticks);
+
+	if (parallel_ticks)
+		free(parallel_ticks);
+
+	if (context)
+		free(context);
+
+	if (measure_context)
+		free(measure_context);
+
+	return ret;
+}
+
+/**	Ƚĵĺѡ
+ *	أ
+ *		ͬ-1
+ *		ͬһͬĺѡ
+ */
+static int CompareContextCandidates(PIMCONTEXT *context1, PIMCONTEXT *context2)
+{
+	TCHAR string1[MAX_SPW_LENGTH + 2], string2[MAX_SPW_LENGTH + 2];
+	int i;
+
+	for (i = 0; i < context1->candidate_count && i < context2->candidate_count; i++)
+	{
+		if (context1->candidate_array[i].type != context2->candidate_array[i].type)
+			return i;
+
+		GetCandidateString(context1, &context1->candidate_array[i], string1, MAX_SPW_LENGTH);
+		GetCandidateString(context2, &context2->candidate_array[i], string2, MAX_SPW_LENGTH);
+		if (_tcscmp(string1, string2))
+			return i;
+	}
+
+	return context1->candidate_count == context2->candidate_count ? -1 : i;
+}
+
+/**	طŰļʹù̻߳õĺѡ˳õĺѡǷͬ
+ *	˳ʹụ֮̀߳ĵĸʹù߳»
+ *	ѡȽϡÿλúѡ֮ǰӺѡ޸ļַʽ²Ҵʿ⣻
+ *	ʱûȫĺѡٱȽϡ
+ *	
+ *		trace_file_name		ļ
+ *		report_file_name	ļ
+ *	أ
+ *		ȫͬ1
+ *		вͬĺѡʧܣ0
+ */
+int ReplayCheckWorkers(const TCHAR *trace_file_name, const TCHAR *report_file_name)
+{
+	extern int resource_thread_finished;
+	FILE *fr = 0, *fw = 0;
+	PIMCONTEXT *context = 0, *worker_context = 0;
+	TCHAR line[REPLAY_MAX_LINE_LENGTH];
+	TCHAR *p;
+	TCHAR ch;
+	int virtual_key, length, index;
+	int key_count = 0, line_count = 0, diff_count = 0;
+	int ret = 0;
+
+	do
+	{
+		while (!resource_thread_finished)
+			Sleep(0);
+
+		fr = _tfopen(trace_file_name, TEXT("rb"));
+		if (!fr)
+		{
+			Log(LOG_ID, L"ļ<%s>޷", trace_file_name);
+			break;
+		}
+
+		fw = _tfopen(report_file_name, TEXT("wt"));
+		if (!fw)
+		{
+			Log(LOG_ID, L"ļ<%s>޷", report_file_name);
+			break;
+		}
+
+		context		   = malloc(sizeof(PIMCONTEXT));
+		worker_context = malloc(sizeof(PIMCONTEXT));
+		if (!context || !worker_context)
+		{
+			Log(LOG_ID, L"ڴʧ");
+			break;
+		}
+
+		FirstTimeResetContext(context);
+		context->capital	= 0;
+		context->input_mode = CHINESE_MODE;
+
+		_ftprintf(fw, TEXT("%c"), 0xFEFF);
+		_ftprintf(fw, TEXT("У%s\n߳%d\n\n"), trace_file_name, GetWorkerCount());
+
+		//FFFE
+		fseek(fr, 2, SEEK_SET);
+
+		while (key_count < REPLAY_MAX_KEYS && GetLineFromFile(fr, line, _SizeOf(line)))
+		{
+			if (line[0] == 0 || line[0] == '#' || line[0] == 0xd || line[0] == 0xa)
+				continue;
+
+			line_count++;
+			for (p = line; key_count < REPLAY_MAX_KEYS && (length = GetReplayKey(p, &virtual_key, &ch)) > 0; p += length)
+			{
+				//˳úѡ
+				share_segment->candidate_data_version++;
+				worker_serial = 1;
+				ProcessKey(context, 0, virtual_key, ch);
+				while (RefineCandidates(context))
+					;
+				worker_serial = 0;
+
+				key_count++;
+
+				if (!context->candidate_count)
+					continue;
+
+				//ʹù߳»úѡ
+				memcpy(worker_context, context, sizeof(PIMCONTEXT));
+				share_segment->candidate_data_version++;
+				MakeCandidate(worker_context);
+				while (RefineCandidates(worker_context))
+					;
+
+				index = CompareContextCandidates(context, worker_context);
+				if (index == -1)
+					continue;
+
+				diff_count++;
+				_ftprintf(fw, TEXT("%dУλ%dѡ%dͬ˳%d%d\n"),
+						  line_count, (int)(p - line) + length, index, context->candidate_count, worker_context->candidate_count);
+			}
+
+			ResetContext(context);
+		}
+
+		_ftprintf(fw, TEXT("\n%d%dѡͬİ%d\n"), line_count, key_count, diff_count);
+
+		ret = !diff_count;
+	}while(0);
+
+	worker_serial = 0;
+
+	if (fr)
+		fclose(fr);
+
+	if (fw)
+		fclose(fw);
+
+	if (context)
+		free(context);
+
+	if (worker_context)
+		free(worker_context);
+
+	return ret;
+}
@@ -101,12 +101,14 @@ SHARE_SEGMENT default_share_segment =
 		TEXT("HYPIM_WORDLIB_SHARED_NAME30"),
 		TEXT("HYPIM_WORDLIB_SHARED_NAME31"),
 	},
+	{ 0 },								//ʿ޸ļڸ̴ʿĸ£
 
 	0,									//ʻǷѾڴ
 
 	{CI_CACHE_V66_SIGNATURE, 0, 0, 0},
 	0,									//ǷѾװ
 	0,									//Ƿı
+	{ 0 },								//cache
 
 	//{0, {0},},
 	//0,									//Ƿװ
@@ -1402,6 +1404,9 @@ SHARE_SEGMENT default_share_segment =
 	0,									//ϢǷѾװ
 
 	0,                                  //font map loaded?
+	0,                                  //gbk map genernate?
+
+	0,									//ѡ޸ļ
 };
 
 int LoadSharedSegment()
@@ -378,7 +378,53 @@ typedef struct tagSPFUZZYMAPITEM
 SPFUZZYMAPITEM sp_fuzzy_map[MAX_SYLLABLE_PER_INPUT];
 int sp_fuzzy_map_items;
 
-/*	жϵһڲָʾĸǷڶڲĸ
+#define	SYLLABLE_MATCH_TABLES		8						//ƥĿ
+#define	SYLLABLE_MATCH_FUZZY_MASK	((FUZZY_SUPER << 1) - 1)	//Ӱƥģ
+#define	SYLLABLE_MATCH_FUZZY_BITS	26						//Ӱƥģλ
+#define	SYLLABLE_MATCH_CHECK_BITS	3						//ƥʱȫϵģĿ
+#define	SYLLABLE_MATCH_CHECK_RANDOM	1024					//ƥʱѡȡģĿ
+
+//ƥģģøıʱɣڱȽʱֻҪ
+typedef struct tagSYLLABLEMATCHTABLE
+{
+	int					fuzzy_mode;				//ģ
+
+	//ĸƥ䣺[Դĸ][ԴĸࣺաUͷ][ǷΪHUͷ]λʾĸ
+	unsigned int		con[32][3][2];
+
+	//ĸƥ䣺[Դĸ][Դĸࣺjqxyfh][ĸࣺաfh]λʾĸ
+	unsigned __int64	vow[64][4][4];
+} SYLLABLEMATCHTABLE;
+
+static SYLLABLEMATCHTABLE syllable_match_tables[SYLLABLE_MATCH_TABLES];
+static int syllable_match_table_count = 0;
+static int last_syllable_match_table = 0;
+static int next_syllable_match_table = 0;
+
+//ĸƥʱԴĸķ
+static const unsigned char vow_match_con_class[32] =
+{
+	3, 3, 3, 3, 3, 1, 3, 2, 0, 3, 3, 3, 3, 3, 0, 3,
+	3, 3, 3, 3, 0, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+};
+
+//ĸƥʱĸķ
+static const unsigned char vow_match_checked_con_class[32] =
+{
+	0, 3, 3, 3, 3, 1, 3, 2, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+};
+
+#define	CON_MATCH_VOW_CLASS(syllable)	((syllable).vow == VOW_NULL ? 0 : ((syllable).vow >= VOW_U && (syllable).vow <= VOW_UO) ? 1 : 2)
+
+#define	CON_MATCH(table, syllable, checked_syllable)	\
+	(((table)->con[(syllable).con][CON_MATCH_VOW_CLASS(syllable)][IS_START_WITH_HU(checked_syllable)] >> (checked_syllable).con) & 1)
+
+#define	VOW_MATCH(table, syllable, checked_syllable)	\
+	((int)(((table)->vow[(syllable).vow][vow_match_con_class[(syllable).con]][vow_match_checked_con_class[(checked_syllable).con]] >> (checked_syllable).vow) & 1))
+
+/*	ģжϵһڲָʾĸǷڶڲĸ
+ *	ֻƥȽʱʹContainCon
  *	
  *		syllable				Դ
  *		checked_syllable		
@@ -387,7 +433,7 @@ int sp_fuzzy_map_items;
  *		1			
  *		0			
  */
-int ContainCon(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode)
+static int ContainConByRule(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode)
 {
 //дꡣ
 #define	CHECK_FUZZY(fuzzy_bit, con_value)	((fuzzy_mode & fuzzy_bit) && (checked_syllable.con == con_value))
@@ -645,7 +691,8 @@ INLINE static int ProcessSPFuzzy(SYLLABLE syllable, SYLLABLE checked_syllable)
 	return 0;
 }
 
-/*	жϵһڲָʾĸǷڶڲĸ
+/*	ģжϵһڲָʾĸǷڶڲĸ
+ *	ֻƥȽʱʹContainVow
  *	
  *		syllable				Դ
  *		checked_syllable		
@@ -654,7 +701,7 @@ INLINE static int ProcessSPFuzzy(SYLLABLE syllable, SYLLABLE checked_syllable)
  *		1			
  *		0			
  */
-int ContainVow(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode)
+static int ContainVowByRule(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode)
 {
 #define	CHECK_FUZZY(fuzzy_bit, vow_value)	((fuzzy_mode & fuzzy_bit) && (checked_syllable.vow == vow_value))
 
@@ -759,6 +806,359 @@ int ContainVow(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode)
 #undef	CHECK_FUZZY
 }
 
+/*	ĸı루ʿֵеıͬa-zΪ1-260Ϊûĸ
+ */
+static int GetSyllableLetterCode(SYLLABLE syllable)
+{
+	TCHAR letter = GetSyllableFirstLetter(syllable);
+
+	return letter >= 'a' && letter <= 'z' ? letter - 'a' + 1 : 0;
+}
+
+/*	ʹƥԴݵڿܵĸĸݵڶ루ٱȽ
+ *	ĸûĸڼݵĸĸƵģԼ˫ƴ
+ *	Ψһʱڡ
+ *	
+ *		table					ƥ
+ *		syllable				Դڣͨ
+ *		fuzzy_mode				ģ
+ *	أ
+ *		ĸļϣiλΪi
+ */
+static unsigned int GetFirstLettersInTable(const SYLLABLEMATCHTABLE *table, SYLLABLE syllable, int fuzzy_mode)
+{
+	SYLLABLE checked_syllable = {0};
+	unsigned __int64 vows;
+	unsigned int cons, letters = 0;
+	int i, j;
+
+	//κڶ
+	if (syllable.con == CON_NULL && syllable.vow == VOW_NULL)
+		return (1u << ('z' - 'a' + 2)) - 1;
+
+	//ǷΪHUͷ
+	cons = table->con[syllable.con][CON_MATCH_VOW_CLASS(syllable)][0] | table->con[syllable.con][CON_MATCH_VOW_CLASS(syllable)][1];
+	for (i = CON_NULL + 1; i < CON_END; i++)
+	{
+		if (!((cons >> i) & 1))
+			continue;
+
+		checked_syllable.con = i;
+		letters |= 1u << GetSyllableLetterCode(checked_syllable);
+	}
+
+	if (cons & (1u << CON_NULL))
+	{
+		//Դûĸʱĸݵκڶ
+		vows = syllable.vow == VOW_NULL
+			? ~(unsigned __int64)0
+			: table->vow[syllable.vow][vow_match_con_class[syllable.con]][vow_match_checked_con_class[CON_NULL]];
+
+		checked_syllable.con = CON_NULL;
+		for (i = VOW_NULL; i < VOW_END; i++)
+		{
+			if (!((vows >> i) & 1))
+				continue;
+
+			checked_syllable.vow = i;
+			letters |= 1u << GetSyllableLetterCode(checked_syllable);
+		}
+	}
+
+	//Ƶģ
+	if ((fuzzy_mode & FUZZY_HUANG_WANG) && syllable.con == CON_H && syllable.vow == VOW_UANG)
+		letters |= 1u << ('w' - 'a' + 1);
+
+	if ((fuzzy_mode & FUZZY_REV_HUANG_WANG) && syllable.con == CON_W && syllable.vow == VOW_ANG)
+		letters |= 1u << ('h' - 'a' + 1);
+
+	//˫ƴΨһ
+	if (pim_config->pinyin_mode == PINYIN_SHUANGPIN)
+	{
+		for (i = 0; i < sp_fuzzy_map_items; i++)
+		{
+			if (syllable.con != sp_fuzzy_map[i].sp_fuzzy_syllables[0].con ||
+				syllable.vow != sp_fuzzy_map[i].sp_fuzzy_syllables[0].vow)
+				continue;
+
+			for (j = 1; j < sp_fuzzy_map[i].sp_fuzzy_syllable_count; j++)
+				letters |= 1u << GetSyllableLetterCode(sp_fuzzy_map[i].sp_fuzzy_syllables[j]);
+		}
+	}
+
+	return letters;
+}
+
+/*	ĸǷȫڵĸȫĸĸϣ˫ƴģ
+ *	
+ *		table					ƥ
+ *	أ
+ *		1			
+ *		0			
+ */
+static int CheckFirstLettersInTable(const SYLLABLEMATCHTABLE *table)
+{
+	SYLLABLE syllable = {0}, checked_syllable = {0};
+	unsigned int letters;
+
+	for (syllable.con = 0; syllable.con < CON_END; syllable.con++)
+		for (syllable.vow = 0; syllable.vow < VOW_END; syllable.vow++)
+		{
+			letters = GetFirstLettersInTable(table, syllable, table->fuzzy_mode);
+
+			for (checked_syllable.con = 0; checked_syllable.con < CON_END; checked_syllable.con++)
+				for (checked_syllable.vow = 0; checked_syllable.vow < VOW_END; checked_syllable.vow++)
+				{
+					if ((letters >> GetSyllableLetterCode(checked_syllable)) & 1)
+						continue;
+
+					if ((syllable.con == CON_NULL && syllable.vow == VOW_NULL) ||
+						ProcessHUANGAndWANG(syllable, checked_syllable, table->fuzzy_mode) ||
+						ProcessWANGAndHUANG(syllable, checked_syllable, table->fuzzy_mode) ||
+						(CON_MATCH(table, syllable, checked_syllable) &&
+						 (syllable.vow == VOW_NULL || VOW_MATCH(table, syllable, checked_syllable))))
+						return 0;
+				}
+		}
+
+	return 1;
+}
+
+/*	ƥģĽǷһ£ȫĸĸϣ
+ *	
+ *		table					ƥ
+ *	أ
+ *		1			һ
+ *		0			һ
+ */
+static int CheckSyllableMatchTable(const SYLLABLEMATCHTABLE *table)
+{
+	SYLLABLE syllable = {0}, checked_syllable = {0};
+
+	for (syllable.con = 0; syllable.con <= CON_ANY; syllable.con++)
+		for (syllable.vow = 0; syllable.vow <= VOW_ANY; syllable.vow++)
+			for (checked_syllable.con = 0; checked_syllable.con <= CON_ANY; checked_syllable.con++)
+				for (checked_syllable.vow = 0; checked_syllable.vow <= VOW_ANY; checked_syllable.vow++)
+				{
+					if (CON_MATCH(table, syllable, checked_syllable) != ContainConByRule(syllable, checked_syllable, table->fuzzy_mode) ||
+						VOW_MATCH(table, syllable, checked_syllable) != ContainVowByRule(syllable, checked_syllable, table->fuzzy_mode))
+						return 0;
+				}
+
+	return 1;
+}
+
+/*	ģõƥ
+ *	ĸֻԴĸǷΪաǷΪUͷԼǷΪHUͷйأĸ
+ *	ֻĸǷΪjqxyfhйأÿһеһĸĸɼɡ
+ *	
+ *		table					ƥ
+ *		fuzzy_mode				ģ
+ *	أ
+ */
+static void MakeSyllableMatchTable(SYLLABLEMATCHTABLE *table, int fuzzy_mode)
+{
+	static const int con_class_vow[3]		  = { VOW_NULL, VOW_U, VOW_A };
+	static const int vow_class_con[4]		  = { CON_J, CON_F, CON_H, CON_B };
+	static const int vow_checked_class_con[4] = { CON_NULL, CON_F, CON_H, CON_B };
+	SYLLABLE syllable = {0}, checked_syllable = {0};
+	int con, vow, checked, i, j;
+
+	table->fuzzy_mode = fuzzy_mode;
+
+	for (con = 0; con < 32; con++)
+	{
+		for (i = 0; i < 3; i++)
+		{
+			for (j = 0; j < 2; j++)
+			{
+				table->con[con][i][j] = 0;
+
+				syllable.con		 = con;
+				syllable.vow		 = con_class_vow[i];
+				checked_syllable.vow = j ? VOW_U : VOW_A;
+
+				for (checked = 0; checked < 32; checked++)
+				{
+					checked_syllable.con = checked;
+					if (ContainConByRule(syllable, checked_syllable, fuzzy_mode))
+						table->con[con][i][j] |= 1u << checked;
+				}
+			}
+		}
+	}
+
+	for (vow = 0; vow < 64; vow++)
+	{
+		for (i = 0; i < 4; i++)
+		{
+			for (j = 0; j < 4; j++)
+			{
+				table->vow[vow][i][j] = 0;
+
+				syllable.con		 = vow_class_con[i];
+				syllable.vow		 = vow;
+				checked_syllable.con = vow_checked_class_con[j];
+
+				for (checked = 0; checked < 64; checked++)
+				{
+					checked_syllable.vow = checked;
+					if (ContainVowByRule(syllable, checked_syllable, fuzzy_mode))
+						table->vow[vow][i][j] |= (unsigned __int64)1 << checked;
+				}
+			}
+		}
+	}
+
+#ifdef	_DEBUG
+	assert(CheckSyllableMatchTable(table));
+#endif
+}
+
+/*	ģõƥûɣ滻ɵı
+ *	
+ *		fuzzy_mode				ģ
+ *	أ
+ *		ƥ
+ */
+static const SYLLABLEMATCHTABLE *GetSyllableMatchTable(int fuzzy_mode)
+{
+	int i, last = last_syllable_match_table;		//߳ͬʱȽʱֻȡһ
+
+	fuzzy_mode &= SYLLABLE_MATCH_FUZZY_MASK;
+
+	if (syllable_match_table_count && syllable_match_tables[last].fuzzy_mode == fuzzy_mode)
+		return &syllable_match_tables[last];
+
+	for (i = 0; i < syllable_match_table_count; i++)
+	{
+		if (syllable_match_tables[i].fuzzy_mode == fuzzy_mode)
+		{
+			last_syllable_match_table = i;
+			return &syllable_match_tables[i];
+		}
+	}
+
+	i = next_syllable_match_table;
+	next_syllable_match_table = (next_syllable_match_table + 1) % SYLLABLE_MATCH_TABLES;
+	if (syllable_match_table_count < SYLLABLE_MATCH_TABLES)
+		syllable_match_table_count++;
+
+	MakeSyllableMatchTable(&syllable_match_tables[i], fuzzy_mode);
+	last_syllable_match_table = i;
+
+	return &syllable_match_tables[i];
+}
+
+/*	ģõƥ߳еڱȽֻеıɡ
+ *	
+ *		fuzzy_mode				ģ
+ */
+void PrepareSyllableMatchTable(int fuzzy_mode)
+{
+	GetSyllableMatchTable(fuzzy_mode);
+}
+
+/*	ԴݣContainSyllableڿܵĸڴʿҳֵĹˡ
+ *	ģãz/zhl/n/ƣԼ˫ƴΨһʱڡ
+ *	
+ *		syllable				Դڣͨ
+ *		fuzzy_mode				ģ
+ *	أ
+ *		ĸļϣiλΪia-zΪ1-260Ϊûĸ
+ */
+unsigned int GetSyllableFirstLetters(SYLLABLE syllable, int fuzzy_mode)
+{
+	return GetFirstLettersInTable(GetSyllableMatchTable(fuzzy_mode), syllable, fuzzy_mode);
+}
+
+/*	жǷģõƥõģ3ûõ
+ *	ģ3ģֻģ֮以Ӱ죩
+ */
+static int IsCheckedFuzzyMode(int fuzzy_mode)
+{
+	int i, count;
+
+	for (i = count = 0; i < 32; i++)
+		if (fuzzy_mode & (1 << i))
+			count++;
+
+	return count <= SYLLABLE_MATCH_CHECK_BITS || count >= SYLLABLE_MATCH_FUZZY_BITS - SYLLABLE_MATCH_CHECK_BITS;
+}
+
+/*	ƥģĽǷһ£ڴʿ⹤ߣģõȫ
+ *	ࣨ2^26˼ûûõģ3ȫϣԼ
+ *	ѡȡϡ
+ *	
+ *		checked_count			ģĿ
+ *	أ
+ *		һµģĿ
+ */
+int CheckSyllableMatchTables(int *checked_count)
+{
+	static SYLLABLEMATCHTABLE table;
+	unsigned int random = 1;
+	int fuzzy_mode, error_count = 0, i;
+
+	*checked_count = 0;
+	for (i = -SYLLABLE_MATCH_CHECK_RANDOM; i <= SYLLABLE_MATCH_FUZZY_MASK; i++)
+	{
+		if (i < 0)
+		{
+			random		= random * 1103515245 + 12345;
+			fuzzy_mode	= (int)(random >> 4) & SYLLABLE_MATCH_FUZZY_MASK;
+		}
+		else if (IsCheckedFuzzyMode(i))
+			fuzzy_mode = i;
+		else
+			continue;
+
+		MakeSyllableMatchTable(&table, fuzzy_mode);
+		(*checked_count)++;
+
+		if (!CheckSyllableMatchTable(&table))
+		{
+			Log(LOG_ID, L"ģ0x%xƥģһ", fuzzy_mode);
+			error_count++;
+		}
+		else if (!CheckFirstLettersInTable(&table))
+		{
+			Log(LOG_ID, L"ģ0x%xĸ", fuzzy_mode);
+			error_count++;
+		}
+	}
+
+	return error_count;
+}
+
+/*	жϵһڲָʾĸǷڶڲĸ
+ *	
+ *		syllable				Դ
+ *		checked_syllable		
+ *		fuzzy_mode				ģ
+ *	أ
+ *		1			
+ *		0			
+ */
+int ContainCon(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode)
+{
+	return CON_MATCH(GetSyllableMatchTable(fuzzy_mode), syllable, checked_syllable);
+}
+
+/*	жϵһڲָʾĸǷڶڲĸ
+ *	
+ *		syllable				Դ
+ *		checked_syllable		
+ *		fuzzy_mode				ģ
+ *	أ
+ *		1			
+ *		0			
+ */
+int ContainVow(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode)
+{
+	return VOW_MATCH(GetSyllableMatchTable(fuzzy_mode), syllable, checked_syllable);
+}
+
 /*	ʹıȽϣжϵһڲָʾڼǷڶڲ
  *	Դֻĸʱͬĸκڶͬġ
  *	
@@ -771,6 +1171,8 @@ int ContainVow(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode)
  */
 int ContainSyllable(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode)
 {
+	const SYLLABLEMATCHTABLE *table;
+
 	if (syllable.con == CON_F && syllable.vow == VOW_AN &&
 		checked_syllable.con == CON_H && checked_syllable.vow == VOW_ANG)
 		fuzzy_mode = fuzzy_mode;
@@ -796,15 +1198,17 @@ int ContainSyllable(SYLLABLE syllable, SYLLABLE checked_syllable, int fuzzy_mode
 		!(syllable.tone & checked_syllable.tone))						//
 		return 0;
 
+	table = GetSyllableMatchTable(fuzzy_mode);
+
 	//ĸͬ򷵻زͬ
-	if (!ContainCon(syllable, checked_syllable, fuzzy_mode))
+	if (!CON_MATCH(table, syllable, checked_syllable))
 		return 0;
 
 	//ԴڵĸΪգȽϽΪͬ
 	if (syllable.vow == VOW_NULL)
 		return 1;
 
-	return ContainVow(syllable, checked_syllable, fuzzy_mode);
+	return VOW_MATCH(table, syllable, checked_syllable);
 }
 
 /*	ıȽϣжϵһڲָʾǷڶڲ
@@ -1174,65 +1578,173 @@ int GetLegalPinYinLength(const TCHAR *pin_yin, int state, int english_state)
 	return i;
 }
 
-/*	õݹķʽƴ
+//ڸ󳤶ȣʱƴͬ
+#define	MAX_LATTICE_LENGTH		(MAX_INPUT_LENGTH + 0x10)
+
+//ƴڸƴÿλÿʼкϷڣ뷴á
+//valid[pos][len]ʾposʼΪlenƴǷΪϷڡ
+typedef struct tagSYLLABLELATTICE
+{
+	int			length;												//ƴ
+	char		valid[MAX_LATTICE_LENGTH][MAX_PINYIN_LENGTH + 1];		//ǷΪϷ
+	SYLLABLE	syllables[MAX_LATTICE_LENGTH][MAX_PINYIN_LENGTH + 1];	//Ϸ
+}SYLLABLELATTICE;
+
+//ڸĽ״̬¼ѾʧܵģλãʣĿظ
+typedef struct tagLATTICEPARSE
+{
+	const TCHAR			*pin_yin;									//ƴ
+	SYLLABLELATTICE		*lattice;									//ڸ
+	int					start;										//ʼλ
+	int					end;										//λ
+	char				(*failed)[MAX_LATTICE_LENGTH + 1];			//ʧܼ¼
+}LATTICEPARSE;
+
+//һΰƴԼ״̬ÿ˽Уƴֻβı䣨׷ӡɾĸʱ
+//ǰ治䲿ֵڸԼʧܼ¼ȻЧֻҪıĲ֡
+typedef struct tagPINYINPARSESTATE
+{
+	int					valid;										//״̬ǷЧ
+	int					fuzzy_mode;									//ģ
+	int					start;										//ʼλ
+	TCHAR				pin_yin[MAX_LATTICE_LENGTH];				//ƴΧڣ
+	SYLLABLELATTICE		lattice;									//ڸ
+	char				reverse_failed[MAX_LATTICE_LENGTH + 1][MAX_LATTICE_LENGTH + 1];	//ʧܼ¼
+}PINYINPARSESTATE;
+
+static PINYINPARSESTATE last_parse_state;
+
+/*	ƴڸڸǰkeep_lengthַڵڱֲ䣬ַֻڡ
  *	
  *		pin_yin				ƴ
+ *		length				ƴ
+ *		fuzzy_mode			ģ
+ *		lattice				ڸ
+ *		keep_length			ڸԭƴͬǰ׺ȣ0ʾȫ¹죩
+ *	ֵ
+ *		ɹ1
+ *		ʧܣƴ0
+ */
+static int MakeSyllableLattice(const TCHAR *pin_yin, int length, int fuzzy_mode, SYLLABLELATTICE *lattice, int keep_length)
+{
+	TCHAR cur_py[MAX_PINYIN_LENGTH + 1];
+	int pos, i, syllable_string_length;
+
+	if (length >= MAX_LATTICE_LENGTH)
+		return 0;
+
+	//ΪMAX_PINYIN_LENGTHǰλÿʼڲıַ
+	lattice->length = length;
+	for (pos = max(0, keep_length - MAX_PINYIN_LENGTH + 1); pos < length; pos++)
+	{
+		lattice->valid[pos][0] = 0;
+		for (i = 1; i <= MAX_PINYIN_LENGTH; i++)
+		{
+			if (pos + i <= keep_length)
+				continue;
+
+			lattice->valid[pos][i] = 0;
+			if (pos + i > length)
+				continue;
+
+			CopyPartString(cur_py, pin_yin + pos, i);
+			if (GetSyllable(cur_py, &lattice->syllables[pos][i], &syllable_string_length, fuzzy_mode))
+				lattice->valid[pos][i] = 1;
+		}
+	}
+
+	return 1;
+}
+
+/*	һΰĽ״̬µƴֻԭƴͬβ
+ *	
+ *		pin_yin				ƴ
+ *		start				ʼλ
+ *		end					λ
+ *		fuzzy_mode			ģ
+ *	ֵ
+ *		ɹ1
+ *		ʧܣƴ0
+ */
+static int UpdateParseState(const TCHAR *pin_yin, int start, int end, int fuzzy_mode)
+{
+	PINYINPARSESTATE *state = &last_parse_state;
+	int keep_length = 0;
+	int i;
+
+	if (end >= MAX_LATTICE_LENGTH)
+	{
+		state->valid = 0;
+		return 0;
+	}
+
+	//ͬǰ׺
+	if (state->valid && state->fuzzy_mode == fuzzy_mode && state->start == start)
+		while (keep_length < end && keep_length < state->lattice.length && pin_yin[keep_length] == state->pin_yin[keep_length])
+			keep_length++;
+
+	MakeSyllableLattice(pin_yin, end, fuzzy_mode, &state->lattice, keep_length);
+
+	//λͬǰ׺ڵķʧܼ¼ȻЧ
+	for (i = keep_length + 1; i <= end; i++)
+		memset(state->reverse_failed[i], 0, sizeof(state->reverse_failed[i]));
+
+	for (i = keep_length; i < end; i++)
+		state->pin_yin[i] = pin_yin[i];
+
+	state->valid	  = 1;
+	state->fuzzy_mode = fuzzy_mode;
+	state->start	  = start;
+
+	return 1;
+}
+
+/*	ڸƴÿλãʣĿֻһΡ
+ *	
+ *		parse				״̬
+ *		pos					ǰλ
  *		*syllables			ڴ洢
  *		array_length		鳤
- *		fuzzy_mode			ģ
  *	ֵ
  *		0ûнȷĽ
  *		> 0Ŀ
  */
-static int ProcessParse(const TCHAR *pin_yin, SYLLABLE *syllables, int array_length, int fuzzy_mode/*, int *correct_flag, int *separator_flag*/)
+static int ParseLatticeForward(LATTICEPARSE *parse, int pos, SYLLABLE *syllables, int array_length)
 {
-	int i, ret;
-	int py_length;									//ƴ
-	int syllable_string_length;						//ַ
-	TCHAR cur_py[MAX_PINYIN_LENGTH + 1];			//ǰʱƴ
-	TCHAR new_pin_yin[MAX_INPUT_LENGTH + 0x10];
-
-	assert(pin_yin && syllables);
+	int i, ret, key;
 
 	//зַ
-	if (*pin_yin == SYLLABLE_SEPARATOR_CHAR)
-		pin_yin++;
+	if (pos < parse->end && parse->pin_yin[pos] == SYLLABLE_SEPARATOR_CHAR)
+		pos++;
 
-	//ٵݹֱӷִ
-	if (*pin_yin == 'i' || *pin_yin == 'u' || *pin_yin == 'v')
+	if (pos >= parse->end)
 		return 0;
 
-	if (IS_TONE(*pin_yin))
+	//ֱӷִ
+	if (parse->pin_yin[pos] == 'i' || parse->pin_yin[pos] == 'u' || parse->pin_yin[pos] == 'v')
 		return 0;
 
-	//py_length = (int)_tcslen(pin_yin);
-	py_length = GetLegalPinYinLength(pin_yin, STATE_EDIT, ENGLISH_STATE_NONE);
-	//ƴַȴ󳤶ƣ˳
-	if ( py_length > _SizeOf(new_pin_yin) )
+	if (IS_TONE(parse->pin_yin[pos]))
 		return 0;
-	_tcsncpy_s(new_pin_yin, _SizeOf(new_pin_yin), pin_yin, py_length);
 
-	for (i = min(MAX_PINYIN_LENGTH, py_length); i > 0; i--)
+	//ʣĿʣƴʱͬ
+	key = min(array_length, MAX_LATTICE_LENGTH);
+	if (parse->failed[pos][key])
+		return 0;
+
+	for (i = min(MAX_PINYIN_LENGTH, parse->end - pos); i > 0; i--)
 	{
-		//Ƶһܵ
-		CopyPartString(cur_py, new_pin_yin, i);
+		if (!parse->lattice->valid[pos][i])
+			continue;			//ǺϷڣһٴμ
 
-		//ҺϷƴ
-		if (!GetSyllable(cur_py, syllables, &syllable_string_length, fuzzy_mode/*, correct_flag, separator_flag*/))
-			continue;			//ûҵһٴμ
+		syllables[0] = parse->lattice->syllables[pos][i];
 
-		//ûҪƴˣݹ || ûпռ
-		if (py_length == i || array_length == 1)
+		//ûҪƴ || ûпռ
+		if (parse->end - pos == i || array_length == 1)
 			return 1;
 
 		//ҵһڣʣ
-		ret = ProcessParse(new_pin_yin + syllable_string_length, 
-						   syllables + 1, 
-						   array_length - 1, 
-						   fuzzy_mode//, 
-						   /*correct_flag ? correct_flag + 1 : 0,*/
-						   /*separator_flag ? separator_flag + 1 : 0*/);
-
+		ret = ParseLatticeForward(parse, pos + i, syllables + 1, array_length - 1);
 		if (!ret)
 			continue;			//ûкϷڣ磺liһΪlԶûкϷ
 
@@ -1241,9 +1753,105 @@ static int ProcessParse(const TCHAR *pin_yin, SYLLABLE *syllables, int array_len
 	}
 
 	//ûҵ
+	parse->failed[pos][key] = 1;
+	return 0;
+}
+
+/*	ڸƴÿλãʣĿֻһΡ
+ *	
+ *		parse				״̬
+ *		end					ǰλ
+ *		*syllables			ڴ洢飨
+ *		array_length		鳤
+ *	ֵ
+ *		0ûнȷĽ
+ *		> 0Ŀ
+ */
+static int ParseLatticeReverse(LATTICEPARSE *parse, int end, SYLLABLE *syllables, int array_length)
+{
+	int i, ret, key;
+	int py_length = end - parse->start;
+
+	if (py_length <= 0)
+		return 0;
+
+	key = min(array_length, MAX_LATTICE_LENGTH);
+	if (parse->failed[end][key])
+		return 0;
+
+	for (i = min(MAX_PINYIN_LENGTH, py_length); i > 0; i--)
+	{
+		if (!parse->lattice->valid[end - i][i])
+			continue;			//ǺϷڣһٴμ
+
+		syllables[0] = parse->lattice->syllables[end - i][i];
+
+		//ûҪƴ || ûпռ
+		if (py_length == i || array_length == 1)
+			return 1;
+
+		//ҵһڣǰ
+		ret = ParseLatticeReverse(parse, end - i, syllables + 1, array_length - 1);
+		if (!ret)
+			continue;
+
+		//ڻ
+		return ret + 1;
+	}
+
+	//ûҵ
+	parse->failed[end][key] = 1;
 	return 0;
 }
 
+/*	ƴķΧʼзַţһдĸΪֹ
+ */
+static void GetParseRange(const TCHAR *pin_yin, int *start, int *end)
+{
+	*start = (*pin_yin == SYLLABLE_SEPARATOR_CHAR) ? 1 : 0;
+	*end   = *start + GetLegalPinYinLength(pin_yin + *start, STATE_EDIT, ENGLISH_STATE_NONE);
+}
+
+/*	ƴڣԭݹĽͬ
+ *	
+ *		pin_yin				ƴ
+ *		lattice				ڸ0ʾҪ죩
+ *		*syllables			ڴ洢
+ *		array_length		鳤
+ *		fuzzy_mode			ģ
+ *	ֵ
+ *		0ûнȷĽ
+ *		> 0Ŀ
+ */
+static int ProcessParse(const TCHAR *pin_yin, SYLLABLELATTICE *lattice, SYLLABLE *syllables, int array_length, int fuzzy_mode)
+{
+	SYLLABLELATTICE	local_lattice;
+	LATTICEPARSE	parse;
+	char			failed[MAX_LATTICE_LENGTH + 1][MAX_LATTICE_LENGTH + 1];
+
+	assert(pin_yin && syllables);
+
+	if (array_length <= 0)
+		return 0;
+
+	GetParseRange(pin_yin, &parse.start, &parse.end);
+
+	if (!lattice)
+	{
+		lattice = &local_lattice;
+		if (!MakeSyllableLattice(pin_yin, parse.end, fuzzy_mode, lattice, 0))
+			return 0;
+	}
+
+	//ʧܼ¼λйأÿζҪֻõĲ֣
+	parse.pin_yin = pin_yin;
+	parse.lattice = lattice;
+	parse.failed  = failed;
+	memset(failed, 0, sizeof(failed[0]) * (parse.end + 1));
+
+	return ParseLatticeForward(&parse, 0, syllables, array_length);
+}
+
 /*	˫ƴнĵݹ
  */
 static int ProcessParseSPInternal(const TCHAR *pin_yin, SYLLABLE *syllables, int array_length, int fuzzy_mode)
@@ -1304,74 +1912,40 @@ static int ProcessParseSP(const TCHAR *pin_yin, SYLLABLE *syllables, int array_l
 	return ProcessParseSPInternal(pin_yin, syllables, array_length, fuzzy_mode);
 }
 
-/*	õݹķʽƴ
+/*	ƴڣԭݹĽͬ
  *	
  *		pin_yin				ƴ
- *		*syllables			ڴ洢
+ *		lattice				ڸ
+ *		failed				ʧܼ¼λƴδı䲿ڵļ¼Ա
+ *		*syllables			ڴ洢飨
  *		array_length		鳤
- *		fuzzy_mode			ģ
  *	ֵ
  *		0ûнȷĽ
  *		> 0Ŀ
  */
-static int ProcessParseReverse(const TCHAR *pin_yin, SYLLABLE *syllables, int array_length, int fuzzy_mode/* ,int *correct_flag, int *separator_flag*/)
+static int ProcessParseReverse(const TCHAR *pin_yin, SYLLABLELATTICE *lattice, char (*failed)[MAX_LATTICE_LENGTH + 1], SYLLABLE *syllables, int array_length)
 {
-	int i, ret;
-	int py_length;													//ƴ
-	int syllable_string_length;										//ַ
-	TCHAR cur_py[MAX_PINYIN_LENGTH * MAX_SYLLABLE_PER_INPUT + 1];	//ǰʱƴ
-	TCHAR new_pin_yin[MAX_INPUT_LENGTH + 0x10];
-
-	assert(pin_yin && syllables);
+	LATTICEPARSE	parse;
 
-	//зַ
-	if (*pin_yin == SYLLABLE_SEPARATOR_CHAR)
-		pin_yin++;
+	assert(pin_yin && lattice && failed && syllables);
 
-	//ٵݹֱӷִ
-	if (*pin_yin == 'i' || *pin_yin == 'u' || *pin_yin == 'v')
+	if (array_length <= 0)
 		return 0;
 
-	if (IS_TONE(*pin_yin))
-		return 0;
+	GetParseRange(pin_yin, &parse.start, &parse.end);
 
-	//py_length = (int)_tcslen(pin_yin);
-	py_length = GetLegalPinYinLength(pin_yin, STATE_EDIT, ENGLISH_STATE_NONE);
-	//ƴַȴ󳤶ƣ˳
-	if ( py_length > _SizeOf(new_pin_yin) )
+	//ֱӷִ
+	if (pin_yin[parse.start] == 'i' || pin_yin[parse.start] == 'u' || pin_yin[parse.start] == 'v')
 		return 0;
-	_tcsncpy_s(new_pin_yin, _SizeOf(new_pin_yin), pin_yin, py_length);
 
-	for (i = min(MAX_PINYIN_LENGTH, py_length); i > 0; i--)
-	{
-		//ҺϷƴ
-		if (!GetSyllable(new_pin_yin + py_length - i, syllables, &syllable_string_length, fuzzy_mode/*, correct_flag, separator_flag*/))
-			continue;			//ûҵһٴμ
-
-		//ûҪƴˣݹ || ûпռ
-		if (py_length == i || array_length == 1)
-			return 1;
-
-		//Ƶһܵ
-		CopyPartString(cur_py, new_pin_yin, py_length - i);
-
-		//ҵһڣʣ
-		ret = ProcessParseReverse(cur_py, 
-								  syllables + 1, 
-								  array_length - 1, 
-								  fuzzy_mode//, 
-								  /*correct_flag ? correct_flag + 1 : 0, */
-								  /*separator_flag ? separator_flag + 1 : 0*/);
-
-		if (!ret)
-			continue;			//ûкϷڣ磺liһΪlԶûкϷ
+	if (IS_TONE(pin_yin[parse.start]))
+		return 0;
 
-		//ڻ
-		return ret + 1;
-	}
+	parse.pin_yin = pin_yin;
+	parse.lattice = lattice;
+	parse.failed  = failed;
 
-	//ûҵ
-	return 0;
+	return ParseLatticeReverse(&parse, parse.end, syllables, array_length);
 }
 
 /*	жƴǷΪϷġ
@@ -1511,7 +2085,7 @@ int ParsePinYinString(const TCHAR *pin_yin, SYLLABLE *syllables, int array_lengt
 	if (!LegalPinYin(pin_yin))
 		return 0;
 
-	return ProcessParse(pin_yin, syllables, array_length, fuzzy_mode/*, correct_flag, separator_flag*/);
+	return ProcessParse(pin_yin, 0, syllables, array_length, fuzzy_mode/*, correct_flag, separator_flag*/);
 }
 
 //ǷҪ
@@ -1598,6 +2172,7 @@ int ParsePinYinStringReverse(const TCHAR *pin_yin, SYLLABLE *syllables, int arra
 	int count, other_count;		//Ŀ
 	SYLLABLE tmp_syllable;		//ʱ
 	SYLLABLE tmp_syllables[MAX_SYLLABLE_PER_INPUT];
+	int start, end;				//Χ
 
 	//int tmp_correct_flag = 0;
 	//int tmp_correct_flags[MAX_SYLLABLE_PER_INPUT] = {0};
@@ -1611,9 +2186,14 @@ int ParsePinYinStringReverse(const TCHAR *pin_yin, SYLLABLE *syllables, int arra
 	if (!LegalPinYin(pin_yin))
 		return 0;
 
+	//ֽһڸڸԼʧܼ¼һν״̬µõֻıβ
+	GetParseRange(pin_yin, &start, &end);
+	if (!UpdateParseState(pin_yin, start, end, fuzzy_mode))
+		return 0;
+
 	//ֽķУһֵĿʹһͬʹ÷ġ
-	count = ProcessParseReverse(pin_yin, syllables, array_length, fuzzy_mode/*, correct_flag, separator_flag*/);
-	other_count = ProcessParse(pin_yin, tmp_syllables, array_length, fuzzy_mode/*, tmp_correct_flags, tmp_separator_flags*/);
+	count = ProcessParseReverse(pin_yin, &last_parse_state.lattice, last_parse_state.reverse_failed, syllables, array_length/*, correct_flag, separator_flag*/);
+	other_count = ProcessParse(pin_yin, &last_parse_state.lattice, tmp_syllables, array_length, fuzzy_mode/*, tmp_correct_flags, tmp_separator_flags*/);
 
 	if ((other_count < count)) //IsSpecialPinYinStr(pin_yin))		//Ľ
 	{
@@ -1926,11 +2506,22 @@ int SyllableStartWithLetter(TCHAR ch, SYLLABLE syllable)
 	if (ch == SYLLABLE_ANY_CHAR)
 		return 1;
 
+	return ch && ch == GetSyllableFirstLetter(syllable);
+}
+
+/*	ڵĸ
+ *	
+ *		syllable		
+ *	أ
+ *		ĸڷ0
+ */
+TCHAR GetSyllableFirstLetter(SYLLABLE syllable)
+{
 	if (syllable.con != CON_NULL)			//ĸ
-		return ch == con_to_string[syllable.con][0];
+		return con_to_string[syllable.con][0];
 
 	if (syllable.vow != VOW_NULL)			//ûĸ
-		return ch == vow_to_string[syllable.vow][0];
+		return vow_to_string[syllable.vow][0];
 
 	return 0;
 }
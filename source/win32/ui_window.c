@@ -793,6 +793,25 @@ LRESULT WINAPI UIWindowProcedure(HWND ui_window, UINT message, WPARAM wParam, LP
 			}
 			break;
 
+		//䳬ʱûȫĺѡʱѾϢٴβ䣩
+		case UIM_REFINE_CANDIDATE:
+			if (!context || !RefineCandidates(context))
+				break;
+
+			if (pim_config->support_ime_aware && !no_ime_aware)
+			{
+				MakeCompositionAndCandidate(pIMC, context);
+				GenerateImeMessage(hIMC, WM_IME_COMPOSITION, 0, GCS_COMPSTR | GCS_CURSORPOS);
+				GenerateImeMessage(hIMC, WM_IME_NOTIFY, IMN_CHANGECANDIDATE, 1);
+			}
+			else
+				Ime_Notify(ui_window, IMN_CHANGECANDIDATE, 1);
+
+			if (context->candidate_incomplete)
+				PostMessage(ui_window, UIM_REFINE_CANDIDATE, 0, 0);
+
+			break;
+
 		//֧IMEԶ֪ĳͨϢп
 		case UIM_NOTIFY:
 			Log(LOG_ID, L"UIMϢ");
@@ -0,0 +1,1159 @@
+/*	ʿ顣
+ *	ΪÿʿڱнڴʺѡĲң
+ *	1ʿеĴУĸĸγ
+ *	2ÿڵӦеһ䣬ʱֻڣģ
+ *	   ݵȫĸԼҳ
+ *	3ޣWORDLIB_TRIE_DEPTHڽڵ˳Ƚϣ
+ *	4Ĵ޸ĴʿͨеĴʿ޸ļ
+ *	   ֪ͨؽ
+ *	⽨ԼΪĴɢбӡɾʱжϴǷѾڣ
+ *	ĸΪĸĸʱֱӶֲң
+ *	ԼÿҳļֵҳʱֻȽ϶ļֵ֧SSE2ʱһαȽ4
+ */
+#include <assert.h>
+#include <kernel.h>
+#include <syllable.h>
+#include <wordlib.h>
+#include <wordlib_index.h>
+#include <config.h>
+#include <utility.h>
+#include <ci.h>
+#include <share_segment.h>
+
+//ûʹ/arch:SSE2Ҫ֧־ɵĴx86SSE2ɨʱѡ
+#if defined(_M_X64) || defined(_M_IX86)
+#define	WORDLIB_KEY_SSE2
+#include <emmintrin.h>
+
+//Ƿ֧SSE2-1Ϊδ
+static int wordlib_key_sse2 = -1;
+#endif
+
+//еĴʿ
+static WORDLIBTRIE *wordlib_trie[MAX_WORDLIBS * 2] = { 0 };
+
+//еĴʿɢб
+static WORDLIBHASH *wordlib_hash[MAX_WORDLIBS * 2] = { 0 };
+
+//еĴʿĸ
+static WORDLIBLETTERINDEX *wordlib_letter_index[MAX_WORDLIBS * 2] = { 0 };
+
+//еĴʿҳֵ
+static WORDLIBPAGEKEYS *wordlib_page_keys[MAX_WORDLIBS * 2] = { 0 };
+
+//ĸʱʹõĴʿָ
+static char *trie_wordlib_data;
+
+//ĸʱĴ
+typedef struct tagLETTERSORTITEM
+{
+	int				item_pos;						//ƫ
+	int				order;							//ҳе˳
+} LETTERSORTITEM;
+
+//ʱĲ
+typedef struct tagTRIESEARCH
+{
+	int				wordlib_id;						//ʿʶ
+	char			*wordlib_data;					//ʿ
+	WORDLIBTRIE		*trie;							//
+	SYLLABLE		*syllable_array;				//
+	int				syllable_count;					//ڳ
+	int				min_count;						//ʵСڳȣǰ׺ʱСڳȣ
+	CANDIDATE		*candidate_array;				//ѡ
+	int				candidate_length;				//ѡ鳤
+	int				count;							//ѡ
+	int				fuzzy_mode;						//ģѡ
+	int				wild_compare;					//ǷʹͨȽ
+} TRIESEARCH;
+
+/**	˳򣺰Уͬʱմλá
+ *	Ƚϴָ룬ʹþ̬Ĵʿָ루߳пͬʱͬʿ
+ */
+static int CompareTrieItem(WORDLIBITEM * const *item1, WORDLIBITEM * const *item2)
+{
+	int ret;
+
+	ret = CompareSyllableKey((*item1)->syllable, (*item1)->syllable_length, (*item2)->syllable, (*item2)->syllable_length);
+	if (ret)
+		return ret;
+
+	return *item1 < *item2 ? -1 : *item1 > *item2;
+}
+
+/**	ڵ
+ *	أ
+ *		ɹڵλ
+ *		ʧܣ-1
+ */
+static int NewTrieNode(WORDLIBTRIE *trie, int *node_capacity)
+{
+	WORDLIBTRIENODE *nodes;
+
+	if (trie->node_count == *node_capacity)
+	{
+		nodes = realloc(trie->nodes, sizeof(WORDLIBTRIENODE) * *node_capacity * 2);
+		if (!nodes)
+			return -1;
+
+		trie->nodes = nodes;
+		*node_capacity *= 2;
+	}
+
+	memset(&trie->nodes[trie->node_count], 0, sizeof(WORDLIBTRIENODE));
+
+	return trie->node_count++;
+}
+
+/**	ͷ
+ */
+static void FreeWordLibTrie(WORDLIBTRIE *trie)
+{
+	if (!trie)
+		return;
+
+	if (trie->nodes)
+		free(trie->nodes);
+
+	if (trie->items)
+		free(trie->items);
+
+	free(trie);
+}
+
+/**	ʿ
+ *	
+ *		wordlib			ʿָ
+ *		version			ʿ޸ļ
+ *	أ
+ *		ɹ
+ *		ʧܣ0
+ */
+static WORDLIBTRIE *BuildWordLibTrie(WORDLIB *wordlib, int version)
+{
+	WORDLIBTRIE	*trie;
+	WORDLIBITEM	*item, **sort_items;
+	PAGE		*page;
+	SYLLABLE	syllable;
+	int			node_capacity, level_start, level_end, depth;
+	int			node, child, i, j;
+
+	trie = malloc(sizeof(WORDLIBTRIE));
+	if (!trie)
+		return 0;
+
+	memset(trie, 0, sizeof(WORDLIBTRIE));
+	trie->version = version;
+
+	//ͳƴ
+	for (i = 0; i < wordlib->header.page_count; i++)
+	{
+		page = &wordlib->pages[i];
+		for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+			trie->item_count++;
+	}
+
+	trie->items = malloc(sizeof(int) * (trie->item_count + 1));
+	node_capacity = trie->item_count / 2 + 1;
+	trie->nodes = malloc(sizeof(WORDLIBTRIENODE) * node_capacity);
+	if (!trie->items || !trie->nodes)
+	{
+		FreeWordLibTrie(trie);
+		return 0;
+	}
+
+	sort_items = malloc(sizeof(WORDLIBITEM*) * (trie->item_count + 1));
+	if (!sort_items)
+	{
+		FreeWordLibTrie(trie);
+		return 0;
+	}
+
+	//
+	trie->item_count = 0;
+	for (i = 0; i < wordlib->header.page_count; i++)
+	{
+		page = &wordlib->pages[i];
+		for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+			sort_items[trie->item_count++] = item;
+	}
+
+	qsort(sort_items, trie->item_count, sizeof(WORDLIBITEM*), CompareTrieItem);
+
+	for (i = 0; i < trie->item_count; i++)
+		trie->items[i] = (int)((char*)sort_items[i] - (char*)wordlib);
+
+	free(sort_items);
+
+	//ڵ
+	node = NewTrieNode(trie, &node_capacity);
+	trie->nodes[node].item_start = 0;
+	trie->nodes[node].item_end	 = trie->item_count;
+
+	//㽨ӽڵ㣬ͬһڵӽڵ
+	level_start = 0;
+	level_end	= 1;
+	for (depth = 0; depth < WORDLIB_TRIE_DEPTH; depth++)
+	{
+		for (node = level_start; node < level_end; node++)
+		{
+			trie->nodes[node].first_child = trie->node_count;
+
+			//ڳȵڽڵȵĴ
+			for (i = trie->nodes[node].item_start; i < trie->nodes[node].item_end; i++)
+				if ((int)((WORDLIBITEM*)((char*)wordlib + trie->items[i]))->syllable_length > depth)
+					break;
+
+			while (i < trie->nodes[node].item_end)
+			{
+				syllable = ((WORDLIBITEM*)((char*)wordlib + trie->items[i]))->syllable[depth];
+				syllable.tone = TONE_0;
+
+				for (j = i + 1; j < trie->nodes[node].item_end; j++)
+				{
+					item = (WORDLIBITEM*)((char*)wordlib + trie->items[j]);
+					if (item->syllable[depth].con != syllable.con || item->syllable[depth].vow != syllable.vow)
+						break;
+				}
+
+				child = NewTrieNode(trie, &node_capacity);
+				if (child == -1)
+				{
+					FreeWordLibTrie(trie);
+					return 0;
+				}
+
+				trie->nodes[child].syllable	  = syllable;
+				trie->nodes[child].item_start = i;
+				trie->nodes[child].item_end	  = j;
+				trie->nodes[node].child_count++;
+
+				i = j;
+			}
+		}
+
+		level_start = level_end;
+		level_end	= trie->node_count;
+	}
+
+	Log(LOG_ID, L"ʿ:%dڵ:%d", trie->item_count, trie->node_count);
+
+	return trie;
+}
+
+/**	ôʿʿѾ޸ģ½
+ */
+static WORDLIBTRIE *GetWordLibTrie(int wordlib_id, WORDLIB *wordlib)
+{
+	int version = share_segment->wordlib_version[wordlib_id];
+
+	if (wordlib_trie[wordlib_id] && wordlib_trie[wordlib_id]->version == version)
+		return wordlib_trie[wordlib_id];
+
+	FreeWordLibTrie(wordlib_trie[wordlib_id]);
+	wordlib_trie[wordlib_id] = BuildWordLibTrie(wordlib, version);
+
+	return wordlib_trie[wordlib_id];
+}
+
+/**	жϴǷϲҪ
+ */
+static int MatchTrieItem(TRIESEARCH *search, WORDLIBITEM *item)
+{
+	int length = search->syllable_count;
+
+	if (!(search->fuzzy_mode & FUZZY_CI_SYLLABLE_LENGTH))
+		if (item->ci_length != item->syllable_length)
+			return 0;
+
+	if (search->wild_compare)
+	{
+		if (!WildCompareSyllables(search->syllable_array, search->syllable_count, item->syllable, item->syllable_length, search->fuzzy_mode))
+			return 0;
+	}
+	else
+	{
+		//ǰ׺ʱͬȵǰ׺Ƚ
+		length = item->syllable_length;
+		if (length < search->min_count || length > search->syllable_count ||
+			!CompareSyllables(search->syllable_array, item->syllable, length, search->fuzzy_mode))
+			return 0;
+	}
+
+	//ڲʱ
+	if (search->fuzzy_mode & FUZZY_CI_TONE)
+		return CiContainTone(search->syllable_array, length, item, search->wild_compare);
+
+	return 1;
+}
+
+/**	뵽ѡ
+ */
+static void AddTrieCandidate(TRIESEARCH *search, WORDLIBITEM *item)
+{
+	CANDIDATE *candidate = &search->candidate_array[search->count++];
+
+	candidate->type			  = CAND_TYPE_CI;
+	candidate->word.type	  = CI_TYPE_NORMAL;
+	candidate->word.source	  = search->wordlib_id;
+	candidate->word.item	  = item;
+	candidate->word.cache_pos = 0;
+	candidate->word.syllable  = GetItemSyllablePtr(item);
+	candidate->word.hz		  = GetItemHZPtr(item);
+}
+
+/**	ĽڵвҴʺѡ
+ *	
+ *		search			Ҳ
+ *		node			ڵλ
+ *		depth			ڵ
+ */
+static void SearchTrieNode(TRIESEARCH *search, int node, int depth)
+{
+	WORDLIBTRIENODE *trie_node = &search->trie->nodes[node];
+	WORDLIBITEM *item;
+	int i;
+
+	if (search->count >= search->candidate_length)
+		return;
+
+	//ȡڽͨ˳Ƚ
+	if (depth == WORDLIB_TRIE_DEPTH || depth == search->syllable_count ||
+		(search->wild_compare && search->syllable_array[depth].con == CON_ANY))
+	{
+		for (i = trie_node->item_start; i < trie_node->item_end && search->count < search->candidate_length; i++)
+		{
+			item = (WORDLIBITEM*)(search->wordlib_data + search->trie->items[i]);
+
+			//ڳȵڽڵȵĴǰ
+			if (!search->wild_compare && depth == search->syllable_count && (int)item->syllable_length != depth)
+				break;
+
+			if (MatchTrieItem(search, item))
+				AddTrieCandidate(search, item);
+		}
+
+		return;
+	}
+
+	//ǰ׺ʱڳȵڽڵȵĴǰ棩ҲǺѡ
+	if (!search->wild_compare && depth && depth >= search->min_count)
+	{
+		for (i = trie_node->item_start; i < trie_node->item_end && search->count < search->candidate_length; i++)
+		{
+			item = (WORDLIBITEM*)(search->wordlib_data + search->trie->items[i]);
+			if ((int)item->syllable_length != depth)
+				break;
+
+			if (MatchTrieItem(search, item))
+				AddTrieCandidate(search, item);
+		}
+	}
+
+	//ֻݵ
+	for (i = 0; i < trie_node->child_count; i++)
+	{
+		if (!ContainSyllable(search->syllable_array[depth], search->trie->nodes[trie_node->first_child + i].syllable, search->fuzzy_mode))
+			continue;
+
+		SearchTrieNode(search, trie_node->first_child + i, depth + 1);
+	}
+}
+
+/**	淶ڣȥjqxyvuͬContainVowһ£
+ */
+static int GetHashSyllable(SYLLABLE syllable)
+{
+	if (syllable.vow == VOW_V &&
+		(syllable.con == CON_J || syllable.con == CON_Q || syllable.con == CON_X || syllable.con == CON_Y))
+		syllable.vow = VOW_U;
+
+	return (syllable.con << 8) | syllable.vow;
+}
+
+/**	ɢֵ
+ */
+static unsigned int GetCiHashValue(HZ *hz, int hz_length, SYLLABLE *syllable, int syllable_length)
+{
+	unsigned int value = 0;
+	int i;
+
+	for (i = 0; i < syllable_length; i++)
+		value = value * 31 + GetHashSyllable(syllable[i]);
+
+	for (i = 0; i < hz_length; i++)
+		value = value * 31 + hz[i];
+
+	return value;
+}
+
+/**	жϴԼǷҪͬ
+ */
+static int IsSameCi(WORDLIBITEM *item, HZ *hz, int hz_length, SYLLABLE *syllable, int syllable_length)
+{
+	int i;
+
+	if ((int)item->ci_length != hz_length || (int)item->syllable_length != syllable_length)
+		return 0;
+
+	for (i = 0; i < syllable_length; i++)
+		if (GetHashSyllable(item->syllable[i]) != GetHashSyllable(syllable[i]))
+			return 0;
+
+	//ͬڲͬһʣGetCiCandidatesıȽһ£
+	for (i = 0; i < syllable_length; i++)
+		if (syllable[i].tone != TONE_0 && item->syllable[i].tone != TONE_0 && !(syllable[i].tone & item->syllable[i].tone))
+			return 0;
+
+	return !memcmp(GetItemHZPtr(item), hz, hz_length * sizeof(HZ));
+}
+
+/**	ɢб
+ *	أ
+ *		ɹ1
+ *		ʧܣûпռ䣩0
+ */
+static int InsertHashItem(WORDLIBHASH *hash, char *wordlib_data, int item_pos)
+{
+	WORDLIBITEM *item = (WORDLIBITEM*)(wordlib_data + item_pos);
+	unsigned int bucket;
+
+	if (hash->item_count >= hash->item_capacity)
+		return 0;
+
+	bucket = GetCiHashValue(GetItemHZPtr(item), item->ci_length, item->syllable, item->syllable_length) & (hash->bucket_count - 1);
+
+	hash->items[hash->item_count] = item_pos;
+	hash->next[hash->item_count]  = hash->buckets[bucket];
+	hash->buckets[bucket]		  = hash->item_count++;
+
+	return 1;
+}
+
+/**	ͷŴɢб
+ */
+static void FreeWordLibHash(WORDLIBHASH *hash)
+{
+	if (!hash)
+		return;
+
+	if (hash->buckets)
+		free(hash->buckets);
+
+	if (hash->items)
+		free(hash->items);
+
+	if (hash->next)
+		free(hash->next);
+
+	free(hash);
+}
+
+/**	ʿĴɢб
+ *	
+ *		wordlib			ʿָ
+ *		version			ʿ޸ļ
+ *	أ
+ *		ɹɢб
+ *		ʧܣ0
+ */
+static WORDLIBHASH *BuildWordLibHash(WORDLIB *wordlib, int version)
+{
+	WORDLIBHASH	*hash;
+	WORDLIBITEM	*item;
+	PAGE		*page;
+	int			item_count, i;
+
+	hash = malloc(sizeof(WORDLIBHASH));
+	if (!hash)
+		return 0;
+
+	memset(hash, 0, sizeof(WORDLIBHASH));
+	hash->version = version;
+
+	item_count = 0;
+	for (i = 0; i < wordlib->header.page_count; i++)
+	{
+		page = &wordlib->pages[i];
+		for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+			item_count++;
+	}
+
+	//ͰĿСڴ
+	hash->item_capacity = item_count + WORDLIB_HASH_EXTRA_ITEMS;
+	for (hash->bucket_count = 1; hash->bucket_count < hash->item_capacity; hash->bucket_count <<= 1)
+		;
+
+	hash->buckets = malloc(sizeof(int) * hash->bucket_count);
+	hash->items	  = malloc(sizeof(int) * hash->item_capacity);
+	hash->next	  = malloc(sizeof(int) * hash->item_capacity);
+	if (!hash->buckets || !hash->items || !hash->next)
+	{
+		FreeWordLibHash(hash);
+		return 0;
+	}
+
+	memset(hash->buckets, -1, sizeof(int) * hash->bucket_count);
+
+	for (i = 0; i < wordlib->header.page_count; i++)
+	{
+		page = &wordlib->pages[i];
+		for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+			InsertHashItem(hash, (char*)wordlib, (int)((char*)item - (char*)wordlib));
+	}
+
+	return hash;
+}
+
+/**	ͨʿҴڡȫͬ
+ *	
+ *		wordlib_id			ʿʶ
+ *		hz					
+ *		hz_length			ֳ
+ *		syllable			ڣܰͨԼֻĸڣ
+ *		syllable_length		ڳ
+ *		item				ҵĴ
+ *	أ
+ *		1ҵ
+ *		0ûҵ
+ *		-1
+ */
+int FindCiInWordLibIndex(int wordlib_id, HZ *hz, int hz_length, SYLLABLE *syllable, int syllable_length, WORDLIBITEM **item)
+{
+	WORDLIBHASH	*hash;
+	WORDLIB		*wordlib;
+	WORDLIBITEM	*cur_item;
+	int			version, index;
+
+	if (wordlib_id < 0 || wordlib_id >= MAX_WORDLIBS * 2)
+		return -1;
+
+	wordlib = GetWordLibrary(wordlib_id);
+	if (!wordlib)
+		return -1;
+
+	//ʿѾ޸ģؽɢб
+	version = share_segment->wordlib_version[wordlib_id];
+	hash	= wordlib_hash[wordlib_id];
+	if (!hash || hash->version != version)
+	{
+		FreeWordLibHash(hash);
+		hash = wordlib_hash[wordlib_id] = BuildWordLibHash(wordlib, version);
+		if (!hash)
+			return -1;
+	}
+
+	index = hash->buckets[GetCiHashValue(hz, hz_length, syllable, syllable_length) & (hash->bucket_count - 1)];
+	for (; index != -1; index = hash->next[index])
+	{
+		cur_item = (WORDLIBITEM*)((char*)wordlib + hash->items[index]);
+		if (IsSameCi(cur_item, hz, hz_length, syllable, syllable_length))
+		{
+			*item = cur_item;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**	ȽϴĸĸȱȽϳȣ
+ */
+static int CompareItemLetters(WORDLIBITEM *item, const TCHAR *letters, int letter_count)
+{
+	int i, ret;
+
+	if ((int)item->syllable_length != letter_count)
+		return (int)item->syllable_length - letter_count;
+
+	for (i = 0; i < letter_count; i++)
+	{
+		ret = (int)GetSyllableFirstLetter(item->syllable[i]) - (int)letters[i];
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/**	ĸ˳򣺰ĸȱȽϳȣͬʱҳе˳
+ */
+static int CompareLetterSortItem(const LETTERSORTITEM *item1, const LETTERSORTITEM *item2)
+{
+	WORDLIBITEM *wl_item1 = (WORDLIBITEM*)(trie_wordlib_data + item1->item_pos);
+	WORDLIBITEM *wl_item2 = (WORDLIBITEM*)(trie_wordlib_data + item2->item_pos);
+	int i, ret;
+
+	if (wl_item1->syllable_length != wl_item2->syllable_length)
+		return (int)wl_item1->syllable_length - (int)wl_item2->syllable_length;
+
+	for (i = 0; i < (int)wl_item1->syllable_length; i++)
+	{
+		ret = (int)GetSyllableFirstLetter(wl_item1->syllable[i]) - (int)GetSyllableFirstLetter(wl_item2->syllable[i]);
+		if (ret)
+			return ret;
+	}
+
+	return item1->order - item2->order;
+}
+
+/**	ĸеĴ뵽ѡ
+ */
+static void AddLetterCandidate(CANDIDATE *candidate, int wordlib_id, WORDLIBITEM *item)
+{
+	candidate->type			  = CAND_TYPE_CI;
+	candidate->word.type	  = CI_TYPE_LETTER;
+	candidate->word.source	  = wordlib_id;
+	candidate->word.item	  = item;
+	candidate->word.cache_pos = 0;
+	candidate->word.syllable  = GetItemSyllablePtr(item);
+	candidate->word.hz		  = GetItemHZPtr(item);
+}
+
+/**	ͷĸ
+ */
+static void FreeWordLibLetterIndex(WORDLIBLETTERINDEX *letter_index)
+{
+	if (!letter_index)
+		return;
+
+	if (letter_index->items)
+		free(letter_index->items);
+
+	free(letter_index);
+}
+
+/**	ʿĸ
+ *	ĸϵ˳ҳֱӱҳʱѡ˳һ¡
+ *	
+ *		wordlib			ʿָ
+ *		version			ʿ޸ļ
+ *	أ
+ *		ɹĸ
+ *		ʧܣ0
+ */
+static WORDLIBLETTERINDEX *BuildWordLibLetterIndex(WORDLIB *wordlib, int version)
+{
+	WORDLIBLETTERINDEX	*letter_index;
+	LETTERSORTITEM		*sort_items;
+	WORDLIBITEM			*item;
+	PAGE				*page;
+	int					page_no, i, j;
+
+	letter_index = malloc(sizeof(WORDLIBLETTERINDEX));
+	if (!letter_index)
+		return 0;
+
+	memset(letter_index, 0, sizeof(WORDLIBLETTERINDEX));
+	letter_index->version = version;
+
+	//ͳƴ
+	for (i = 0; i < wordlib->header.page_count; i++)
+	{
+		page = &wordlib->pages[i];
+		for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+			letter_index->item_count++;
+	}
+
+	letter_index->items = malloc(sizeof(int) * (letter_index->item_count + 1));
+	sort_items = malloc(sizeof(LETTERSORTITEM) * (letter_index->item_count + 1));
+	if (!letter_index->items || !sort_items)
+	{
+		if (sort_items)
+			free(sort_items);
+
+		FreeWordLibLetterIndex(letter_index);
+		return 0;
+	}
+
+	//ĸϱҳ
+	letter_index->item_count = 0;
+	for (i = CON_NULL; i < CON_END; i++)
+		for (j = CON_NULL; j < CON_END; j++)
+			for (page_no = wordlib->header.index[i][j]; page_no != PAGE_END; page_no = wordlib->pages[page_no].next_page_no)
+			{
+				page = &wordlib->pages[page_no];
+				for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+				{
+					sort_items[letter_index->item_count].item_pos = (int)((char*)item - (char*)wordlib);
+					sort_items[letter_index->item_count].order	  = letter_index->item_count;
+					letter_index->item_count++;
+				}
+			}
+
+	trie_wordlib_data = (char*)wordlib;
+	qsort(sort_items, letter_index->item_count, sizeof(LETTERSORTITEM), CompareLetterSortItem);
+	trie_wordlib_data = 0;
+
+	for (i = 0; i < letter_index->item_count; i++)
+		letter_index->items[i] = sort_items[i].item_pos;
+
+	free(sort_items);
+
+	Log(LOG_ID, L"ʿĸ:%d", letter_index->item_count);
+
+	return letter_index;
+}
+
+/*	ͨĸôʻѡĸûͨ
+ *	
+ *		wordlib_id				ʿʶ
+ *		letters					ĸ
+ *		letter_count			ĸĿ
+ *		candidate_array			ѡ
+ *		candidate_length		ѡ鳤
+ *	أ
+ *		ѡʻĿ
+ *		-1ãҪҳ
+ */
+int GetCiInWordLibLetterIndex(int wordlib_id, const TCHAR *letters, int letter_count, CANDIDATE *candidate_array, int candidate_length)
+{
+	WORDLIBLETTERINDEX	*letter_index;
+	WORDLIB				*wordlib;
+	WORDLIBITEM			*item;
+	int					version, low, high, mid, count = 0;
+	int					i;
+
+	if (wordlib_id < 0 || wordlib_id >= MAX_WORDLIBS * 2)
+		return -1;
+
+	wordlib = GetWordLibrary(wordlib_id);
+	if (!wordlib)
+		return -1;
+
+	//ʿѾ޸ģؽ
+	version		 = share_segment->wordlib_version[wordlib_id];
+	letter_index = wordlib_letter_index[wordlib_id];
+	if (!letter_index || letter_index->version != version)
+	{
+		FreeWordLibLetterIndex(letter_index);
+		letter_index = wordlib_letter_index[wordlib_id] = BuildWordLibLetterIndex(wordlib, version);
+		if (!letter_index)
+			return -1;
+	}
+
+	//ҳһСĸĴ
+	low	 = 0;
+	high = letter_index->item_count;
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		if (CompareItemLetters((WORDLIBITEM*)((char*)wordlib + letter_index->items[mid]), letters, letter_count) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	for (i = low; i < letter_index->item_count && count < candidate_length; i++)
+	{
+		item = (WORDLIBITEM*)((char*)wordlib + letter_index->items[i]);
+		if (CompareItemLetters(item, letters, letter_count))
+			break;
+
+		AddLetterCandidate(&candidate_array[count++], wordlib_id, item);
+	}
+
+	//Ĵ
+	for (i = 0; i < letter_index->pending_count && count < candidate_length; i++)
+	{
+		item = (WORDLIBITEM*)((char*)wordlib + letter_index->pending[i]);
+		if (!CompareItemLetters(item, letters, letter_count))
+			AddLetterCandidate(&candidate_array[count++], wordlib_id, item);
+	}
+
+	return count;
+}
+
+/**	ôļֵ
+ */
+unsigned int GetWordLibItemKey(WORDLIBITEM *item)
+{
+	unsigned int key = item->syllable_length & WORDLIB_KEY_LENGTH_MASK;
+	TCHAR letter;
+	int i;
+
+	if (item->ci_length == item->syllable_length)
+		key |= WORDLIB_KEY_SAME_LENGTH;
+
+	for (i = 0; i < WORDLIB_KEY_LETTER_COUNT && i < (int)item->syllable_length; i++)
+	{
+		letter = GetSyllableFirstLetter(item->syllable[i]);
+		if (letter >= 'a' && letter <= 'z')
+			key |= (letter - 'a' + 1) << (WORDLIB_KEY_LETTER_SHIFT + i * WORDLIB_KEY_LETTER_BITS);
+	}
+
+	return key;
+}
+
+/**	ͷҳֵ
+ */
+static void FreeWordLibPageKeys(WORDLIBPAGEKEYS *page_keys)
+{
+	if (!page_keys)
+		return;
+
+	if (page_keys->page_start)
+		free(page_keys->page_start);
+
+	if (page_keys->data_length)
+		free(page_keys->data_length);
+
+	if (page_keys->offsets)
+		free(page_keys->offsets);
+
+	if (page_keys->keys)
+		free(page_keys->keys);
+
+	free(page_keys);
+}
+
+/**	ʿҳֵ
+ *	
+ *		wordlib			ʿָ
+ *		version			ʿ޸ļ
+ *	أ
+ *		ɹҳֵ
+ *		ʧܣ0
+ */
+static WORDLIBPAGEKEYS *BuildWordLibPageKeys(WORDLIB *wordlib, int version)
+{
+	WORDLIBPAGEKEYS	*page_keys;
+	WORDLIBITEM		*item;
+	PAGE			*page;
+	int				item_count = 0;
+	int				i;
+
+	page_keys = malloc(sizeof(WORDLIBPAGEKEYS));
+	if (!page_keys)
+		return 0;
+
+	memset(page_keys, 0, sizeof(WORDLIBPAGEKEYS));
+	page_keys->version	  = version;
+	page_keys->page_count = wordlib->header.page_count;
+
+	//ͳƴ
+	for (i = 0; i < page_keys->page_count; i++)
+	{
+		page = &wordlib->pages[i];
+		for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+			item_count++;
+	}
+
+	page_keys->page_start  = malloc(sizeof(int) * (page_keys->page_count + 1));
+	page_keys->data_length = malloc(sizeof(int) * (page_keys->page_count + 1));
+	page_keys->offsets	   = malloc(sizeof(unsigned short) * (item_count + 1));
+	page_keys->keys		   = malloc(sizeof(unsigned int) * (item_count + 1));
+	if (!page_keys->page_start || !page_keys->data_length || !page_keys->offsets || !page_keys->keys)
+	{
+		FreeWordLibPageKeys(page_keys);
+		return 0;
+	}
+
+	item_count = 0;
+	for (i = 0; i < page_keys->page_count; i++)
+	{
+		page = &wordlib->pages[i];
+		page_keys->page_start[i]  = item_count;
+		page_keys->data_length[i] = page->data_length;
+
+		for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+		{
+			page_keys->offsets[item_count] = (unsigned short)((char*)item - page->data);
+			page_keys->keys[item_count]	   = GetWordLibItemKey(item);
+			item_count++;
+		}
+	}
+
+	page_keys->page_start[page_keys->page_count] = item_count;
+
+	return page_keys;
+}
+
+/**	ڼֵҳҪļֵ
+ *	
+ *		keys			ֵ
+ *		count			ֵĿ
+ *		key_mask		ֵ
+ *		key_value		Ҫļֵ
+ *		hits			Ҫļֵλ
+ *	أ
+ *		ҪļֵĿ
+ */
+static int ScanWordLibKeys(const unsigned int *keys, int count, unsigned int key_mask, unsigned int key_value, int *hits)
+{
+	int hit_count = 0;
+	int i = 0;
+
+#ifdef WORDLIB_KEY_SSE2
+	if (wordlib_key_sse2 < 0)
+		wordlib_key_sse2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) != 0;
+
+	if (wordlib_key_sse2)
+	{
+		__m128i mask  = _mm_set1_epi32((int)key_mask);
+		__m128i value = _mm_set1_epi32((int)key_value);
+		int bits;
+
+		for (; i + 4 <= count; i += 4)
+		{
+			bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128((const __m128i*)(keys + i)), mask), value)));
+			if (!bits)
+				continue;
+
+			if (bits & 1)
+				hits[hit_count++] = i;
+			if (bits & 2)
+				hits[hit_count++] = i + 1;
+			if (bits & 4)
+				hits[hit_count++] = i + 2;
+			if (bits & 8)
+				hits[hit_count++] = i + 3;
+		}
+	}
+#endif
+
+	//ûз֧ıȽϣλд룬ֻзʱż
+	for (; i < count; i++)
+	{
+		hits[hit_count] = i;
+		hit_count += (keys[i] & key_mask) == key_value;
+	}
+
+	return hit_count;
+}
+
+/*	ҳмֵҪĴ
+ *	ֵãҳڽֵ֮޸ʱֱӱҳ
+ *	
+ *		wordlib_id				ʿʶ
+ *		page					ҳָ
+ *		key_mask				ֵ
+ *		key_value				Ҫļֵ(ֵ & key_mask) == key_value
+ *		items					飬ΪWORDLIB_PAGE_MAX_ITEMS
+ *	أ
+ *		Ŀ
+ */
+int GetWordLibPageItems(int wordlib_id, PAGE *page, unsigned int key_mask, unsigned int key_value, WORDLIBITEM **items)
+{
+	WORDLIBPAGEKEYS	*page_keys = 0;
+	WORDLIBITEM		*item;
+	WORDLIB			*wordlib = 0;
+	int				hits[WORDLIB_PAGE_MAX_ITEMS];
+	int				version, page_no = -1, start, count = 0;
+	int				i;
+
+	if (wordlib_id >= 0 && wordlib_id < MAX_WORDLIBS * 2 && (wordlib = GetWordLibrary(wordlib_id)) != 0)
+	{
+		//ʿѾ޸ģؽֵ
+		version	  = share_segment->wordlib_version[wordlib_id];
+		page_keys = wordlib_page_keys[wordlib_id];
+		if (!page_keys || page_keys->version != version)
+		{
+			FreeWordLibPageKeys(page_keys);
+			page_keys = wordlib_page_keys[wordlib_id] = BuildWordLibPageKeys(wordlib, version);
+		}
+	}
+
+	if (page_keys)
+		page_no = (int)(page - wordlib->pages);
+
+	if (page_keys && page_no >= 0 && page_no < page_keys->page_count && page_keys->data_length[page_no] == page->data_length)
+	{
+		start = page_keys->page_start[page_no];
+		count = ScanWordLibKeys(page_keys->keys + start, page_keys->page_start[page_no + 1] - start, key_mask, key_value, hits);
+
+		for (i = 0; i < count; i++)
+			items[i] = (WORDLIBITEM*)(page->data + page_keys->offsets[start + hits[i]]);
+
+		return count;
+	}
+
+	//ֱӱҳ
+	for (item = (WORDLIBITEM*) page->data; (char*)item < (char*) &page->data + page->data_length; item = GetNextCiItem(item))
+		if ((GetWordLibItemKey(item) & key_mask) == key_value)
+			items[count++] = item;
+
+	return count;
+}
+
+/*	ͨʿڳmin_countsyllable_count֮Ĵʣͬȵǰ׺ݣ
+ */
+static int SearchWordLibIndex(int wordlib_id, SYLLABLE *syllable_array, int syllable_count, int min_count,
+							  CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode, int wild_compare)
+{
+	TRIESEARCH	search;
+	WORDLIB		*wordlib;
+	WORDLIBITEM	*item;
+	int			i;
+
+	if (wordlib_id < 0 || wordlib_id >= MAX_WORDLIBS * 2)
+		return -1;
+
+	if (wild_compare && !(pim_config->ci_option & CI_WILDCARD))
+		return 0;
+
+	wordlib = GetWordLibrary(wordlib_id);
+	if (!wordlib)
+		return -1;
+
+	search.trie = GetWordLibTrie(wordlib_id, wordlib);
+	if (!search.trie)
+		return -1;
+
+	search.wordlib_id		= wordlib_id;
+	search.wordlib_data		= (char*)wordlib;
+	search.syllable_array	= syllable_array;
+	search.syllable_count	= syllable_count;
+	search.min_count		= min_count;
+	search.candidate_array	= candidate_array;
+	search.candidate_length	= candidate_length;
+	search.count			= 0;
+	search.fuzzy_mode		= fuzzy_mode;
+	search.wild_compare		= wild_compare;
+
+	SearchTrieNode(&search, 0, 0);
+
+	//Ĵ
+	for (i = 0; i < search.trie->pending_count && search.count < candidate_length; i++)
+	{
+		item = (WORDLIBITEM*)(search.wordlib_data + search.trie->pending[i]);
+		if (MatchTrieItem(&search, item))
+			AddTrieCandidate(&search, item);
+	}
+
+	return search.count;
+}
+
+/*	ͨʿôʻѡ
+ *	
+ *		wordlib_id				ʿʶ
+ *		syllable_array			
+ *		syllable_count			ڳ
+ *		candidate_array			ѡ
+ *		candidate_length		ѡ鳤
+ *		fuzzy_mode				ģѡ
+ *		wild_compare			ǷʹͨȽ
+ *	أ
+ *		ѡʻĿ
+ *		-1ãҪҳ
+ */
+int GetCiInWordLibIndex(int wordlib_id, SYLLABLE *syllable_array, int syllable_count, CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode, int wild_compare)
+{
+	return SearchWordLibIndex(wordlib_id, syllable_array, syllable_count, syllable_count, candidate_array, candidate_length, fuzzy_mode, wild_compare);
+}
+
+/*	ͨʿһλиǰ׺min_countsyllable_countڣĴʻѡ
+ *	ֻһǰݵͬһȵĴʱGetCiInWordLibIndexͬĴ
+ *	
+ *		wordlib_id				ʿʶ
+ *		syllable_array			Уͨ
+ *		syllable_count			ǰ׺
+ *		min_count				ǰ׺
+ *		candidate_array			ѡ
+ *		candidate_length		ѡ鳤
+ *		fuzzy_mode				ģѡ
+ *	أ
+ *		ѡʻĿڳΪsyllable_length
+ *		-1
+ */
+int GetCiPrefixesInWordLibIndex(int wordlib_id, SYLLABLE *syllable_array, int syllable_count, int min_count, CANDIDATE *candidate_array, int candidate_length, int fuzzy_mode)
+{
+	return SearchWordLibIndex(wordlib_id, syllable_array, syllable_count, min_count, candidate_array, candidate_length, fuzzy_mode, 0);
+}
+
+/**	ʿµĴ
+ *	̵µģ򽫴̣̣
+ *	´βʱؽ
+ *	
+ *		wordlib_id			ʿʶ
+ *		item				Ĵ
+ */
+void AddItemToWordLibIndex(int wordlib_id, WORDLIBITEM *item)
+{
+	WORDLIBTRIE *trie;
+	WORDLIBHASH *hash;
+	WORDLIBLETTERINDEX *letter_index;
+	WORDLIBPAGEKEYS *page_keys;
+	WORDLIB *wordlib;
+	int version, item_pos;
+
+	if (wordlib_id < 0 || wordlib_id >= MAX_WORDLIBS * 2)
+		return;
+
+	wordlib = GetWordLibrary(wordlib_id);
+	if (!wordlib)
+		return;
+
+	version	 = share_segment->wordlib_version[wordlib_id];
+	item_pos = (int)((char*)item - (char*)wordlib);
+
+	//ֻµά
+	trie = wordlib_trie[wordlib_id];
+	if (trie && (trie->version != version || trie->pending_count >= WORDLIB_TRIE_MAX_PENDING))
+		trie = 0;
+
+	hash = wordlib_hash[wordlib_id];
+	if (hash && (hash->version != version || !InsertHashItem(hash, (char*)wordlib, item_pos)))
+		hash = 0;
+
+	letter_index = wordlib_letter_index[wordlib_id];
+	if (letter_index && (letter_index->version != version || letter_index->pending_count >= WORDLIB_LETTER_MAX_PENDING))
+		letter_index = 0;
+
+	//ҳֵͨҳݳжҳǷ޸ģҪؽ
+	page_keys = wordlib_page_keys[wordlib_id];
+	if (page_keys && page_keys->version != version)
+		page_keys = 0;
+
+	version = ++share_segment->wordlib_version[wordlib_id];
+	share_segment->candidate_data_version++;
+
+	if (trie)
+	{
+		trie->pending[trie->pending_count++] = item_pos;
+		trie->version = version;
+	}
+
+	if (hash)
+		hash->version = version;
+
+	if (letter_index)
+	{
+		letter_index->pending[letter_index->pending_count++] = item_pos;
+		letter_index->version = version;
+	}
+
+	if (page_keys)
+		page_keys->version = version;
+}
+
+/**	ʿⱻı䣬н̶Ҫؽ
+ */
+void InvalidateWordLibIndex(int wordlib_id)
+{
+	if (wordlib_id < 0 || wordlib_id >= MAX_WORDLIBS * 2)
+		return;
+
+	share_segment->wordlib_version[wordlib_id]++;
+	share_segment->candidate_data_version++;
+}
+
+/**	ͷű̵Ĵʿ
+ */
+void FreeWordLibIndex(int wordlib_id)
+{
+	if (wordlib_id < 0 || wordlib_id >= MAX_WORDLIBS * 2)
+		return;
+
+	FreeWordLibTrie(wordlib_trie[wordlib_id]);
+	wordlib_trie[wordlib_id] = 0;
+
+	FreeWordLibHash(wordlib_hash[wordlib_id]);
+	wordlib_hash[wordlib_id] = 0;
+
+	FreeWordLibLetterIndex(wordlib_letter_index[wordlib_id]);
+	wordlib_letter_index[wordlib_id] = 0;
+
+	FreeWordLibPageKeys(wordlib_page_keys[wordlib_id]);
+	wordlib_page_keys[wordlib_id] = 0;
+}
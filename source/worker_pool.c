@@ -0,0 +1,181 @@
+/*	̳߳ء
+ *	߳ڵһʹʱûʱȴźִһʱ߳뱻ѵ
+ *	߳ͨԭӼȡÿ߳ûȡʱٲ
+ *	߳¼̵߳ȵȫ߽ŷأһʼʱ
+ *	߳ڴһ顣
+ */
+#include <windows.h>
+#include <config.h>
+#include <utility.h>
+#include <worker_pool.h>
+
+int worker_serial = 0;
+
+static HANDLE			worker_threads[WORKER_MAX_THREADS];
+static int				worker_thread_count	   = 0;		//ѾĹ߳Ŀ
+static int				worker_processor_count = 0;		//Ŀ
+static int				worker_pool_failed	   = 0;		//̳߳ʧܣԺֻ˳ִ
+static HANDLE			worker_start_semaphore = 0;		//ѹ̵߳ź
+static HANDLE			worker_done_event	   = 0;		//һȫɵ¼
+static volatile LONG	worker_exit			   = 0;		//߳˳־
+
+static WORKERTASK		*batch_tasks;					//ִе
+static int				batch_task_count;				//Ŀ
+static volatile LONG	batch_next_task;				//һȡ
+static volatile LONG	batch_participants;				//δĲ߳Ŀ̣߳
+
+/**	ȡֱִȫѾȡĲ߳¼
+ */
+static void RunBatchTasks()
+{
+	LONG index;
+
+	while ((index = InterlockedIncrement(&batch_next_task) - 1) < batch_task_count)
+		batch_tasks[index].proc(batch_tasks[index].param);
+
+	if (!InterlockedDecrement(&batch_participants))
+		SetEvent(worker_done_event);
+}
+
+/**	߳
+ */
+static DWORD WINAPI WorkerThreadProc(LPVOID dummy)
+{
+	for (;;)
+	{
+		WaitForSingleObject(worker_start_semaphore, INFINITE);
+		if (worker_exit)
+			break;
+
+		RunBatchTasks();
+	}
+
+	return 0;
+}
+
+/**	ҪĹ߳Ŀ̣߳
+ */
+static int GetConfigWorkerCount()
+{
+	SYSTEM_INFO system_info;
+	int count;
+
+	if (pim_config->candidate_thread_count > 0)
+		count = pim_config->candidate_thread_count - 1;
+	else
+	{
+		if (!worker_processor_count)
+		{
+			GetSystemInfo(&system_info);
+			worker_processor_count = (int)system_info.dwNumberOfProcessors;
+		}
+
+		count = worker_processor_count - 1;
+	}
+
+	return max(0, min(count, WORKER_MAX_THREADS));
+}
+
+/**	ÿʹõĹ߳Ŀһʹʱ߳
+ *	أ
+ *		߳Ŀ̣߳0Ϊֻ˳ִ
+ */
+int GetWorkerCount()
+{
+	int count;
+
+	if (worker_serial || worker_pool_failed)
+		return 0;
+
+	count = GetConfigWorkerCount();
+	if (!count)
+		return 0;
+
+	if (!worker_start_semaphore)
+	{
+		worker_start_semaphore = CreateSemaphore(0, 0, WORKER_MAX_THREADS, 0);
+		worker_done_event	   = CreateEvent(0, FALSE, FALSE, 0);
+
+		if (!worker_start_semaphore || !worker_done_event)
+		{
+			Log(LOG_ID, L"̳߳ʧ");
+			worker_pool_failed = 1;
+			return 0;
+		}
+	}
+
+	while (worker_thread_count < count)
+	{
+		worker_threads[worker_thread_count] = CreateThread(0, 0, WorkerThreadProc, 0, 0, 0);
+		if (!worker_threads[worker_thread_count])
+		{
+			Log(LOG_ID, L"߳ʧܣ߳:%d", worker_thread_count);
+			break;
+		}
+
+		worker_thread_count++;
+	}
+
+	return min(count, worker_thread_count);
+}
+
+/**	ִһȫɺ󷵻ءֻдԼĽ
+ *	ʹʱڴصȱ̹Ŀдݡ
+ *	
+ *		tasks			
+ *		task_count		Ŀ
+ */
+void RunWorkerTasks(WORKERTASK *tasks, int task_count)
+{
+	int wake_count, i;
+
+	wake_count = task_count > 1 ? min(GetWorkerCount(), task_count - 1) : 0;
+	if (wake_count <= 0)
+	{
+		for (i = 0; i < task_count; i++)
+			tasks[i].proc(tasks[i].param);
+
+		return;
+	}
+
+	batch_tasks		   = tasks;
+	batch_task_count   = task_count;
+	batch_next_task	   = 0;
+	batch_participants = wake_count + 1;
+
+	ReleaseSemaphore(worker_start_semaphore, wake_count, 0);
+
+	//߳Ҳȡ
+	RunBatchTasks();
+
+	WaitForSingleObject(worker_done_event, INFINITE);
+}
+
+/**	ọ̈̄߳DllMainеã
+ */
+void FreeWorkerPool()
+{
+	int i;
+
+	if (worker_thread_count)
+	{
+		worker_exit = 1;
+		ReleaseSemaphore(worker_start_semaphore, worker_thread_count, 0);
+		WaitForMultipleObjects(worker_thread_count, worker_threads, TRUE, INFINITE);
+
+		for (i = 0; i < worker_thread_count; i++)
+			CloseHandle(worker_threads[i]);
+
+		worker_thread_count = 0;
+		worker_exit			= 0;
+	}
+
+	if (worker_start_semaphore)
+		CloseHandle(worker_start_semaphore);
+
+	if (worker_done_event)
+		CloseHandle(worker_done_event);
+
+	worker_start_semaphore = 0;
+	worker_done_event	   = 0;
+}
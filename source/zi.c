@@ -32,6 +32,24 @@
 static HZDATAHEADER *hz_data	 = 0;
 static TCHAR *hz_data_share_name = TEXT("HYPIM_HZ_DATA_SHARED_NAME");
 
+//ֱÿ˽У
+//1ֱգĸĸ֣ͬһڣĺţ
+//   ѡʱֻҪжÿڣȻ䣻
+//2պĺţֲͨҺ
+#define	MAX_ZI_RANGES		((CON_END + 1) * (VOW_END + 1))
+
+typedef struct tagZIRANGE
+{
+	SYLLABLE	syllable;						//ڣ
+	int			start;							//俪ʼĺ
+	int			end;							//ĺţ
+}ZIRANGE;
+
+static HZDATAHEADER	*zi_index_data = 0;			//ʱĺֱ
+static ZIRANGE		zi_ranges[MAX_ZI_RANGES];	//
+static int			zi_range_count = 0;			//Ŀ-1Ϊֱࣨû
+static int			*zi_hz_order   = 0;			//
+
 //#pragma data_seg(HYPIM_SHARED_SEGMENT)
 //
 //HZCACHE		hz_cache = { ZICACHE_SIGNATURE, 1, {0}, {0}, };	//Cacheṹ
@@ -420,20 +438,18 @@ static int CompareZi(const CANDIDATE *cand1, const CANDIDATE *cand2)
 	int used_count1, used_count2;
 	int freq1, freq2;
 
+	//ʹöǰѾȡSortZiCandidates
+	used_count1 = cand1->hz.used_count;
+	used_count2 = cand2->hz.used_count;
+
 	if (cand1->hz.is_word)
 	{
 		freq1		= cand1->hz.word_item->freq;
 		freq1		= AdjustWordFreqToHZFreq(freq1);
-
-		if (cand1->hz.cache_pos != -1)
-			used_count1 = GetCiUsedCount(cand1->hz.cache_pos);
-		else
-			used_count1 = 0;
 	}
 	else
 	{
 		freq1		= cand1->hz.item->freq;
-		used_count1 = GetHzUsedCount(cand1->hz.item);
 
 		//ǰȫģʽ and ѡǷֲǼ֣СƵ
 		if (pim_config->hz_output_mode == HZ_OUTPUT_HANZI_ALL &&
@@ -445,16 +461,10 @@ static int CompareZi(const CANDIDATE *cand1, const CANDIDATE *cand2)
 	{
 		freq2		= cand2->hz.word_item->freq;
 		freq2		= AdjustWordFreqToHZFreq(freq2);
-
-		if (cand2->hz.cache_pos != -1)
-			used_count2 = GetCiUsedCount(cand2->hz.cache_pos);
-		else
-			used_count2 = 0;
 	}
 	else
 	{
 		freq2		= cand2->hz.item->freq;
-		used_count2 = GetHzUsedCount(cand2->hz.item);
 
 		//ǰȫģʽҺѡǷֲǼ֣СƵ
 		if (pim_config->hz_output_mode == HZ_OUTPUT_HANZI_ALL &&
@@ -485,11 +495,49 @@ static int CompareZi(const CANDIDATE *cand1, const CANDIDATE *cand2)
 	return freq2 - freq1;
 }
 
-static void SortZiCandidatesInternal(CANDIDATE *candidate_array, int count)
+//ʱڴ治ʱֱںѡѡ
+static void SortZiCandidatesInPlace(CANDIDATE *candidate_array, int count, int top_count)
 {
 	int i, j, k;
 	CANDIDATE temp;
 
+	for (i = 0; i < top_count; i++)
+	{
+		if (candidate_array[i].hz.is_word)
+		{
+			continue;
+		}
+
+		k = i;
+		for (j = i + 1; j < count; j++)
+		{
+			if (candidate_array[j].hz.is_word)
+			{
+				continue;
+			}
+
+			if (GetZiCachePos(candidate_array[j].hz.item) > GetZiCachePos(candidate_array[k].hz.item))
+			{
+				k = j;
+			}
+		}
+
+		if (k != i)
+		{
+			//ƶǽ(֤ѡǰʹö)
+			temp = candidate_array[k];
+			memmove(candidate_array + i + 1, candidate_array + i, (k - i) * sizeof(CANDIDATE));
+			candidate_array[i] = temp;
+		}
+	}
+}
+
+static void SortZiCandidatesInternal(CANDIDATE *candidate_array, int count)
+{
+	TEMPMEMORYMARK mark = GetTempMemoryMark();
+	CANDIDATEHANDLE *handles, temp;
+	int i, j, k, top_count, moved = 0;
+
 	//ֲǹ̶
 	if (!(pim_config->hz_output_mode & HZ_OUTPUT_TRADITIONAL) && (pim_config->hz_option & HZ_USE_FIX_TOP))
 	{
@@ -506,9 +554,23 @@ static void SortZiCandidatesInternal(CANDIDATE *candidate_array, int count)
 		count -= i;
 	}
 
+	//ֻҪǰĺѡʱѡЩλüɣѡǰλòٱ仯
+	top_count = candidate_top_count && candidate_top_count < count ? candidate_top_count : count;
+
+	//ѡֻƶѡһƶѡ
+	handles = AllocateTempMemory(sizeof(CANDIDATEHANDLE) * count);
+	if (!handles)
+	{
+		SortZiCandidatesInPlace(candidate_array, count, top_count);
+		return;
+	}
+
 	for (i = 0; i < count; i++)
+		handles[i] = i;
+
+	for (i = 0; i < top_count; i++)
 	{
-		if (candidate_array[i].hz.is_word)
+		if (candidate_array[handles[i]].hz.is_word)
 		{
 			continue;
 		}
@@ -516,13 +578,13 @@ static void SortZiCandidatesInternal(CANDIDATE *candidate_array, int count)
 		k = i;
 		for (j = i + 1; j < count; j++)
 		{
-			if (candidate_array[j].hz.is_word)
+			if (candidate_array[handles[j]].hz.is_word)
 			{
 				continue;
 			}
 
 			//עhz.cache_posֻСڴʵcacheλ
-			if (GetZiCachePos(candidate_array[j].hz.item) > GetZiCachePos(candidate_array[k].hz.item))
+			if (GetZiCachePos(candidate_array[handles[j]].hz.item) > GetZiCachePos(candidate_array[handles[k]].hz.item))
 			{
 				k = j;
 			}
@@ -531,20 +593,43 @@ static void SortZiCandidatesInternal(CANDIDATE *candidate_array, int count)
 		if (k != i)
 		{
 			//ƶǽ(֤ѡǰʹö)
-			temp = candidate_array[k];
-			memcpy(candidate_array + i + 1, candidate_array + i, (k - i) * sizeof(CANDIDATE));
-			candidate_array[i] = temp;
+			temp = handles[k];
+			memmove(handles + i + 1, handles + i, (k - i) * sizeof(CANDIDATEHANDLE));
+			handles[i] = temp;
+			moved = 1;
 		}
 	}
+
+	//ʱڴ治㲻ʱֱӶԺѡ
+	if (moved && !ArrangeCandidates(candidate_array, handles, count))
+	{
+		FreeTempMemory(mark);
+		SortZiCandidatesInPlace(candidate_array, count, top_count);
+		return;
+	}
+
+	FreeTempMemory(mark);
 }
 
-//Ժֺѡ
+//Ժֺѡcandidate_top_countΪ0ʱֻ֤ǰĺѡ
 void SortZiCandidates(CANDIDATE *candidate_array, int count)
 {
+	int i;
+
 	if (count < 2)			//ܽбȽ
 		return;
 
-	qsort(candidate_array, count, sizeof(CANDIDATE), CompareZi);
+	for (i = 0; i < count; i++)
+	{
+		if (!candidate_array[i].hz.is_word)
+			candidate_array[i].hz.used_count = GetHzUsedCount(candidate_array[i].hz.item);
+		else if (candidate_array[i].hz.cache_pos != -1)
+			candidate_array[i].hz.used_count = GetCiUsedCount(candidate_array[i].hz.cache_pos);
+		else
+			candidate_array[i].hz.used_count = 0;
+	}
+
+	PartialSortCandidates(candidate_array, count, CompareZi);
 
 	//ǿƵҪһbugsys A00000022
 	if (pim_config->hz_option & HZ_ADJUST_FREQ_FAST)
@@ -623,6 +708,111 @@ int ZiContainTone(HZ hz, SYLLABLE syllable, int tone)
 	return (hz_data->hz_item[mid].syllable.tone & tone) != 0;
 }
 
+/**	Ƚĺ֣ͬʱţڽ
+ */
+static int CompareHzOrder(const int *index1, const int *index2)
+{
+	if (hz_data->hz_item[*index1].hz != hz_data->hz_item[*index2].hz)
+		return hz_data->hz_item[*index1].hz < hz_data->hz_item[*index2].hz ? -1 : 1;
+
+	return *index1 - *index2;
+}
+
+/**	ͷźֱ
+ */
+static void FreeZiIndex()
+{
+	if (zi_hz_order)
+		free(zi_hz_order);
+
+	zi_hz_order	   = 0;
+	zi_range_count = 0;
+	zi_index_data  = 0;
+}
+
+/**	ֱֱıؽ
+ *	أ
+ *		ɹ1
+ *		ʧܣ0
+ */
+static int MakeZiIndex()
+{
+	int i;
+
+	if (!hz_data)
+		return 0;
+
+	if (zi_index_data == hz_data)
+		return 1;
+
+	FreeZiIndex();
+
+	//
+	for (i = 0; i < hz_data->hz_count; i++)
+	{
+		if (zi_range_count &&
+			zi_ranges[zi_range_count - 1].syllable.con == hz_data->hz_item[i].syllable.con &&
+			zi_ranges[zi_range_count - 1].syllable.vow == hz_data->hz_item[i].syllable.vow)
+		{
+			zi_ranges[zi_range_count - 1].end = i + 1;
+			continue;
+		}
+
+		if (zi_range_count >= MAX_ZI_RANGES)
+		{
+			Log(LOG_ID, L"ֱ࣬ʹ");
+			zi_range_count = -1;
+			break;
+		}
+
+		zi_ranges[zi_range_count].syllable		= hz_data->hz_item[i].syllable;
+		zi_ranges[zi_range_count].syllable.tone = TONE_0;
+		zi_ranges[zi_range_count].start			= i;
+		zi_ranges[zi_range_count].end			= i + 1;
+		zi_range_count++;
+	}
+
+	//
+	zi_hz_order = malloc(sizeof(int) * (hz_data->hz_count + 1));
+	if (zi_hz_order)
+	{
+		for (i = 0; i < hz_data->hz_count; i++)
+			zi_hz_order[i] = i;
+
+		qsort(zi_hz_order, hz_data->hz_count, sizeof(int), CompareHzOrder);
+	}
+
+	zi_index_data = hz_data;
+
+	return 1;
+}
+
+/**	ͨҳֵĵһ
+ *	أ
+ *		ҵںеλ
+ *		ûҵ-1
+ */
+static int FindHzOrder(UC hz)
+{
+	int start = 0, end, mid;
+
+	end = hz_data->hz_count;
+	while (start < end)
+	{
+		mid = (start + end) / 2;
+
+		if (hz_data->hz_item[zi_hz_order[mid]].hz < hz)
+			start = mid + 1;
+		else
+			end = mid;
+	}
+
+	if (start >= hz_data->hz_count || hz_data->hz_item[zi_hz_order[start]].hz != hz)
+		return -1;
+
+	return start;
+}
+
 /*	úֺѡ
  *	
  *		syllable		
@@ -637,8 +827,11 @@ int ZiContainTone(HZ hz, SYLLABLE syllable, int tone)
  */
 int GetZiCandidates(SYLLABLE syllable, CANDIDATE *candidate_array, int array_length, int fuzzy_mode, int set_mode, int output_mode)
 {
-	int i, j, count;		//ѡ
+	int i, j, r, count;		//ѡ
 	int topzi_count;		//öĿ
+	int use_range, range_count, range_fuzzy_mode;
+	ZIRANGE *ranges, whole_range;
+	SYLLABLE range_syllable;
 	HZ  top_zi[MAX_TOPZI];	//ö
 	int check_top_zcs_fuzzy = 0;	//özcsģ
 	extern int LoadHZDataResource();
@@ -672,56 +865,82 @@ int GetZiCandidates(SYLLABLE syllable, CANDIDATE *candidate_array, int array_len
 		(syllable.con == CON_Z || syllable.con == CON_C || syllable.con == CON_S))
 		check_top_zcs_fuzzy = 1;
 
+	MakeZiIndex();
+
+	//ûʱֱΪһ
+	use_range = zi_range_count > 0;
+	if (use_range)
+	{
+		ranges		= zi_ranges;
+		range_count = zi_range_count;
+	}
+	else
+	{
+		whole_range.start = 0;
+		whole_range.end	  = hz_data->hz_count;
+		ranges			  = &whole_range;
+		range_count		  = 1;
+	}
+
+	//ֻȽĸĸ
+	range_syllable		= syllable;
+	range_syllable.tone = TONE_0;
+	range_fuzzy_mode	= check_top_zcs_fuzzy ? fuzzy_mode | FUZZY_Z_ZH | FUZZY_C_CH | FUZZY_S_SH : fuzzy_mode;
+
 	count = 0;
 	//
-	for (i = 0; i < hz_data->hz_count; i++)
+	for (r = 0; r < range_count && count < array_length; r++)
 	{
-		//жϼǷ
-		if (!(
-			((output_mode & HZ_OUTPUT_HANZI_ALL)) ||								//ȫ
-			((output_mode & HZ_OUTPUT_ICW_ZI) && hz_data->hz_item[i].icw_hz) ||			//ICWʹõĺ
-			((output_mode & HZ_OUTPUT_SIMPLIFIED) && hz_data->hz_item[i].simplified) ||	//֣Ǽ
-			((output_mode & HZ_OUTPUT_TRADITIONAL) && (hz_data->hz_item[i].traditional || hz_data->hz_item[i].other))	//֣Ƿδ
-			))
+		if (use_range && !ContainSyllableWithTone(range_syllable, ranges[r].syllable, range_fuzzy_mode))
 			continue;
 
-		if (check_top_zcs_fuzzy)
+		for (i = ranges[r].start; i < ranges[r].end && count < array_length; i++)
 		{
-			if (!ContainSyllableWithTone(syllable, hz_data->hz_item[i].syllable, fuzzy_mode | FUZZY_Z_ZH | FUZZY_C_CH | FUZZY_S_SH))
+			//жϼǷ
+			if (!(
+				((output_mode & HZ_OUTPUT_HANZI_ALL)) ||								//ȫ
+				((output_mode & HZ_OUTPUT_ICW_ZI) && hz_data->hz_item[i].icw_hz) ||			//ICWʹõĺ
+				((output_mode & HZ_OUTPUT_SIMPLIFIED) && hz_data->hz_item[i].simplified) ||	//֣Ǽ
+				((output_mode & HZ_OUTPUT_TRADITIONAL) && (hz_data->hz_item[i].traditional || hz_data->hz_item[i].other))	//֣Ƿδ
+				))
 				continue;
 
+			if (check_top_zcs_fuzzy)
+			{
+				if (!ContainSyllableWithTone(syllable, hz_data->hz_item[i].syllable, fuzzy_mode | FUZZY_Z_ZH | FUZZY_C_CH | FUZZY_S_SH))
+					continue;
+
+				//жǷΪö
+				for (j = 0; j < topzi_count; j++)
+					if (top_zi[j] == LOWORD(hz_data->hz_item[i].hz))
+						break;
+
+				//öֵĻҪ½ж
+				if (j == topzi_count)
+					if (!ContainSyllableWithTone(syllable, hz_data->hz_item[i].syllable, fuzzy_mode))
+						continue;			//ƴ
+			}
+			else if (!ContainSyllableWithTone(syllable, hz_data->hz_item[i].syllable, fuzzy_mode))
+				continue;			//ƴ
+
+			candidate_array[count].type		  = CAND_TYPE_ZI;
+			candidate_array[count].hz.is_word = 0;
+			candidate_array[count].hz.item	  = &hz_data->hz_item[i];
+			candidate_array[count].hz.hz_type = ZI_TYPE_NORMAL;
+
 			//жǷΪö
 			for (j = 0; j < topzi_count; j++)
 				if (top_zi[j] == LOWORD(hz_data->hz_item[i].hz))
 					break;
 
-			//öֵĻҪ½ж
+			//öţûУΪֵ
 			if (j == topzi_count)
-				if (!ContainSyllableWithTone(syllable, hz_data->hz_item[i].syllable, fuzzy_mode))
-					continue;			//ƴ
-		}
-		else if (!ContainSyllableWithTone(syllable, hz_data->hz_item[i].syllable, fuzzy_mode))
-			continue;			//ƴ
+				j = DEFAULT_TOP_POS;
 
-		candidate_array[count].type		  = CAND_TYPE_ZI;
-		candidate_array[count].hz.is_word = 0;
-		candidate_array[count].hz.item	  = &hz_data->hz_item[i];
-		candidate_array[count].hz.hz_type = ZI_TYPE_NORMAL;
-
-		//жǷΪö
-		for (j = 0; j < topzi_count; j++)
-			if (top_zi[j] == LOWORD(hz_data->hz_item[i].hz))
-				break;
+			candidate_array[count].hz.top_pos = j;
 
-		//öţûУΪֵ
-		if (j == topzi_count)
-			j = DEFAULT_TOP_POS;
-
-		candidate_array[count].hz.top_pos = j;
-
-		count++;
-		if (count >= array_length)			//
-			break;
+			count++;
+		}
 	}
 
 	return count;
@@ -731,6 +950,12 @@ HZITEM* GetSingleZiCandidate(TCHAR zi)
 {
 	int i;
 
+	if (MakeZiIndex() && zi_hz_order)
+	{
+		i = FindHzOrder(zi);
+		return i == -1 ? 0 : &hz_data->hz_item[zi_hz_order[i]];
+	}
+
 	for (i = 0; i < hz_data->hz_count; i++)
 	{
 		if (zi == hz_data->hz_item[i].hz)
@@ -866,6 +1091,7 @@ static void AddHzToCache(HZITEM *item)
 	}
 
 	share_segment->zi_cache_modified = 1;
+	share_segment->candidate_data_version++;
 }
 
 /*	úCacheеID
@@ -889,6 +1115,7 @@ static void AddHzToUsedCount(HZITEM *item)
 
 	share_segment->hz_cache.used_count[GetHzItemIndex(item)]++;
 	share_segment->zi_cache_modified = 1;
+	share_segment->candidate_data_version++;
 }
 
 /*	ֱѡкĸ
@@ -916,6 +1143,27 @@ void ProcessZiSelectedByWord(HZ hz, SYLLABLE syllable)
 
 	//todo:Ҫд
 
+	//ͨ
+	if (MakeZiIndex() && zi_hz_order)
+	{
+		for (i = FindHzOrder(hz); i >= 0 && i < hz_data->hz_count && hz_data->hz_item[zi_hz_order[i]].hz == hz; i++)
+		{
+			if (!ContainSyllableWithTone(syllable, hz_data->hz_item[zi_hz_order[i]].syllable, 0))
+				continue;			//ƴ
+
+			if ((int)hz_data->hz_item[zi_hz_order[i]].freq > max_freq)
+			{
+				index = zi_hz_order[i];
+				max_freq = hz_data->hz_item[index].freq;
+			}
+		}
+
+		if (index != -1)		//ҵ
+			ProcessZiSelected(&hz_data->hz_item[index]);
+
+		return;
+	}
+
 	//
 	for (i = 0; i < hz_data->hz_count; i++)
 	{
@@ -1107,6 +1355,9 @@ int LoadHZData(const TCHAR *hz_data_name)
 
 	share_segment->hz_data_loaded = 1;
 
+	//ֱ
+	MakeZiIndex();
+
 	return 1;
 }
 
@@ -1122,6 +1373,8 @@ int FreeHZData()
 		hz_data = 0;
 	}
 
+	FreeZiIndex();
+
 	return 1;
 }
 
@@ -1296,6 +1549,7 @@ void SetFixTopZi(PIMCONTEXT *context, int no)
 	syllable = context->syllables[i];
 
 	zi = LOWORD(context->candidate_array[index].hz.item->hz);
+	share_segment->candidate_data_version++;
 
 	//Ѱöֵλ
 	//Ѱ